@@ -0,0 +1,164 @@
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "bigint.h"
+#include "libfns.h"
+#include "limbpool.h"
+#include "util.h"
+#include "workpool.h"
+
+//
+// ydcbench -
+//    Times the arithmetic behind ydc's + - * / % ^ and the decimal
+//    parse and print at operand sizes from 10 digits up by powers of
+//    ten, and writes the results to stdout as JSON, one record per
+//    operation and size, for comparison between builds.
+//
+//    Usage: ydcbench [max_digits [min_seconds [threads]]]
+//
+//    Each case is repeated until it has run for min_seconds (default
+//    0.2), and at least once.  Operands are random but the same on
+//    every run.  Allocations are the limbpool requests and heap
+//    allocations behind each operation; strings are not counted.
+//    The context block records the compiler and the flags the
+//    Makefile built the benchmark with.
+//
+
+#ifndef BENCHCPP
+#define BENCHCPP "unknown"
+#endif
+
+struct bench_result {
+   string name;
+   string op;
+   size_t digits;
+   size_t iterations;
+   double ns_per_op;
+   double requests_per_op;
+   double heap_allocs_per_op;
+};
+
+using bench_op = function<void()>;
+
+static mt19937_64 rng (1);
+
+static string random_digits (size_t digits) {
+   string result;
+   result += static_cast<char> ('1' + rng() % 9);
+   while (result.size() < digits) {
+      result += static_cast<char> ('0' + rng() % 10);
+   }
+   return result;
+}
+
+static volatile bool sink;
+
+static bench_result run_case (const string& name, const string& op,
+                              size_t digits, double min_seconds,
+                              const bench_op& body) {
+   using clock = chrono::steady_clock;
+   limbpool::counters before = limbpool::statistics();
+   size_t iterations = 0;
+   clock::time_point start = clock::now();
+   double elapsed = 0;
+   do {
+      body();
+      ++iterations;
+      elapsed = chrono::duration<double> (clock::now() - start)
+                .count();
+   }while (elapsed < min_seconds);
+   limbpool::counters after = limbpool::statistics();
+   double count = static_cast<double> (iterations);
+   return {name, op, digits, iterations, elapsed * 1e9 / count,
+           static_cast<double> (after.requests - before.requests)
+                 / count,
+           static_cast<double> (after.heap_allocs - before.heap_allocs)
+                 / count};
+}
+
+static void write_json (ostream& out,
+                        const vector<bench_result>& results,
+                        size_t max_digits, double min_seconds) {
+   char date[32];
+   time_t now = time (nullptr);
+   strftime (date, sizeof date, "%Y-%m-%dT%H:%M:%S", localtime (&now));
+   out << "{\n"
+       << "  \"context\": {\n"
+       << "    \"date\": \"" << date << "\",\n"
+       << "    \"executable\": \"" << exec::execname() << "\",\n"
+       << "    \"compiler\": \"g++ " << __VERSION__ << "\",\n"
+       << "    \"flags\": \"" << BENCHCPP << "\",\n"
+       << "    \"max_digits\": " << max_digits << ",\n"
+       << "    \"min_seconds\": " << min_seconds << ",\n"
+       << "    \"threads\": " << workpool::threads() << "\n"
+       << "  },\n"
+       << "  \"benchmarks\": [\n";
+   for (size_t index = 0; index < results.size(); ++index) {
+      const bench_result& result = results[index];
+      out << "    {\"name\": \"" << result.name << "/" << result.digits
+          << "\", \"op\": \"" << result.op
+          << "\", \"digits\": " << result.digits
+          << ", \"iterations\": " << result.iterations
+          << ", \"ns_per_op\": " << fixed << result.ns_per_op
+          << ", \"allocs_per_op\": " << result.requests_per_op
+          << ", \"heap_allocs_per_op\": " << result.heap_allocs_per_op
+          << defaultfloat << "}"
+          << (index + 1 < results.size() ? "," : "") << "\n";
+   }
+   out << "  ]\n}\n";
+}
+
+int main (int argc, char** argv) {
+   exec::execname (argv[0]);
+   size_t max_digits = argc > 1 ? strtoul (argv[1], nullptr, 10)
+                                : 1000000;
+   double min_seconds = argc > 2 ? strtod (argv[2], nullptr) : 0.2;
+   if (argc > 3) {
+      workpool::set_threads (strtoul (argv[3], nullptr, 10));
+   }
+   // Every pow case repeats the same arguments, so with the cache
+   // on it would time cache hits rather than the exponentiation.
+   pow_cache::set_capacity (0);
+
+   vector<bench_result> results;
+   for (size_t digits = 10; digits <= max_digits; digits *= 10) {
+      string a_digits = random_digits (digits);
+      bigint a (a_digits);
+      bigint b (random_digits (digits));
+      bigint half (random_digits (max (digits / 2, size_t (1))));
+      bigint seven (7);
+      // An exponent that makes 7^n about as long as the operands.
+      long power = static_cast<long> (ceil (digits / log10 (7.0)));
+      bigint exponent (power);
+      auto run = [&] (const string& name, const string& op,
+                      const bench_op& body) {
+         results.push_back (run_case (name, op, digits, min_seconds,
+                                      body));
+      };
+      run ("add", "+", [&] { sink = (a + b).is_zero(); });
+      run ("sub", "-", [&] { sink = (a - b).is_zero(); });
+      run ("mul", "*", [&] { sink = (a * b).is_zero(); });
+      run ("div", "/", [&] { sink = (a / half).is_zero(); });
+      run ("rem", "%", [&] { sink = (a % half).is_zero(); });
+      run ("pow", "^", [&] { sink = pow (seven, exponent).is_zero(); });
+      run ("parse", "", [&] { sink = bigint (a_digits).is_zero(); });
+      run ("print", "p", [&] {
+         ostringstream out;
+         out << a;
+         sink = out.str().empty();
+      });
+   }
+   write_json (cout, results, max_digits, min_seconds);
+   return EXIT_SUCCESS;
+}
+
@@ -2,23 +2,28 @@
 #include <exception>
 #include <stack>
 #include <stdexcept>
+#include <utility>
 using namespace std;
 
 #include "bigint.h"
 #include "debug.h"
 #include "relops.h"
 
-bigint::bigint (long that): uvalue (that), is_negative (that < 0) {
+bigint::bigint (long that):
+                uvalue (that < 0 ? 0UL - that : that),
+                is_negative (that < 0) {
    DEBUGF ('~', this << " -> " << uvalue)
 }
 
 bigint::bigint (const ubigint& uvalue, bool is_negative):
                 uvalue(uvalue), is_negative(is_negative) {
+   normalize();
 }
 
-bigint::bigint (const string& that) {
+bigint::bigint (string_view that, unsigned radix) {
    is_negative = that.size() > 0 and that[0] == '_';
-   uvalue = ubigint (that.substr (is_negative ? 1 : 0));
+   uvalue = ubigint (that.substr (is_negative ? 1 : 0), radix);
+   normalize();
 }
 
 bigint bigint::operator+ () const {
@@ -29,144 +34,106 @@ bigint bigint::operator- () const {
    return {uvalue, not is_negative};
 }
 
-bigint bigint::operator+ (const bigint& that) const {
-   bigint result;
-   // + sum + OR - sum -
-   // same sign so result.is_negative depends on
-   // sign of that.is_negative (or is_negative)
-   if (is_negative == that.is_negative) {
-      result.uvalue = uvalue + that.uvalue;
-      result.is_negative = that.is_negative;
-   }
-   // - sum +
-   else if (is_negative && not that.is_negative) {
-      if ((uvalue < that.uvalue) || (uvalue == that.uvalue)) {
-         result.uvalue = that.uvalue - uvalue;
-         result.is_negative = false;
-      }
-      else {
-         result.uvalue = uvalue - that.uvalue;
-         result.is_negative = true;
-      }
-   }
-   // + sum -
-   else {
-      if (uvalue < that.uvalue) {
-         result.uvalue = that.uvalue - uvalue;
-         result.is_negative = true;
-      }
-      else if (uvalue == that.uvalue) {
-         result.uvalue = uvalue - that.uvalue;
-         result.is_negative = false;
-      }
-      else {
-         result.uvalue = uvalue - that.uvalue;
-         result.is_negative = false;
-      }
-   }
-   return result;
-}
-
-bigint bigint::operator- (const bigint& that) const {
-   bigint result;
-   // + sub + 
-   if (not is_negative && not that.is_negative) {
-      if (uvalue < that.uvalue) {
-         result.uvalue = that.uvalue - uvalue;
-         result.is_negative = true;
-      }
-      // handles case where:
-      //    uvalue == that.uvalue and
-      //    uvalue > that.uvalue
-      else {
-         result.uvalue = uvalue - that.uvalue;
-         result.is_negative = false;
-      }
-      
-   }
-   // - sub +
-   else if (is_negative && not that.is_negative) {
-      if ((uvalue < that.uvalue) || (uvalue == that.uvalue)) {
-         result.uvalue = that.uvalue - uvalue;
-         result.is_negative = false;
-      }
-      else {
-         result.uvalue = uvalue - that.uvalue;
-         result.is_negative = true;
-      }
-   }
-   // - sub - == - sum +
-   else if (is_negative && that.is_negative) {
-      if ((uvalue < that.uvalue) || (uvalue == that.uvalue)) {
-         result.uvalue = that.uvalue - uvalue;
-         result.is_negative = false;
-      }
-      else {
-         result.uvalue = uvalue - that.uvalue;
-         result.is_negative = true;
-      }
-   }
-   // + sub - == + sum +
-   else {
-      result.uvalue = uvalue + that.uvalue;
-      result.is_negative = false;
-   }
- 
-   return result;
+//
+// add_signed -
+//    Shared by += and -=.  Like signs add magnitudes; unlike signs
+//    subtract the smaller magnitude from the larger, which then
+//    determines the sign.
+//
+
+bigint& bigint::add_signed (const bigint& that, bool negate) {
+   bool that_negative = that.is_negative != negate;
+   if (is_negative == that_negative) {
+      uvalue += that.uvalue;
+   }else if (that.uvalue <= uvalue) {
+      uvalue -= that.uvalue;
+   }else {
+      uvalue.subtract_from (that.uvalue);
+      is_negative = that_negative;
+   }
+   normalize();
+   return *this;
 }
 
-bigint bigint::operator* (const bigint& that) const {
-   
-   bigint result;
-   result.uvalue = uvalue * that.uvalue;
+bigint& bigint::operator+= (const bigint& that) {
+   return add_signed (that, false);
+}
 
-   if (is_negative == that.is_negative) {
-      result.is_negative = false;
-   }
-   else {
-      result.is_negative = true;
-   }
-   
-   return result;
+bigint& bigint::operator-= (const bigint& that) {
+   return add_signed (that, true);
 }
 
-bigint bigint::operator/ (const bigint& that) const {
-   
-   bigint result;
-   result.uvalue = uvalue / that.uvalue;
-   static const bigint ZERO (0);   
+bigint& bigint::operator*= (const bigint& that) {
+   is_negative = is_negative != that.is_negative;
+   uvalue *= that.uvalue;
+   normalize();
+   return *this;
+}
 
-   if (result == ZERO) {
-      result.is_negative = false;
-   }
-   else if (is_negative == that.is_negative) {
-      result.is_negative = false;
-   }
-   else {
-      result.is_negative = true;
-   }
+bigint& bigint::operator/= (const bigint& that) {
+   is_negative = is_negative != that.is_negative;
+   uvalue /= that.uvalue;
+   normalize();
+   return *this;
+}
 
-   return result;
+bigint& bigint::operator%= (const bigint& that) {
+   uvalue %= that.uvalue;
+   normalize();
+   return *this;
 }
 
-bigint bigint::operator% (const bigint& that) const {
-   
-   bigint result;
-   result.uvalue = uvalue % that.uvalue;
-  
-   if (is_negative && that.is_negative) {
-      result.is_negative = true;
-   }
-   else if (not is_negative && not that.is_negative) {
-      result.is_negative = false;
-   }
-   else if (is_negative && not that.is_negative) {
-      result.is_negative = true;
-   }
-   else {
-      result.is_negative = false;
-   }
-   return result;
+bigint& bigint::operator<<= (size_t bits) {
+   uvalue <<= bits;
+   return *this;
+}
+
+bigint& bigint::operator>>= (size_t bits) {
+   uvalue >>= bits;
+   normalize();
+   return *this;
+}
+
+bigint bigint::operator+ (const bigint& that) const& {
+   bigint result {*this};
+   return result += that;
+}
+
+bigint bigint::operator- (const bigint& that) const& {
+   bigint result {*this};
+   return result -= that;
+}
+
+bigint bigint::operator* (const bigint& that) const& {
+   return {uvalue * that.uvalue, is_negative != that.is_negative};
+}
+
+bigint bigint::operator/ (const bigint& that) const& {
+   return {uvalue / that.uvalue, is_negative != that.is_negative};
+}
+
+bigint bigint::operator% (const bigint& that) const& {
+   return {uvalue % that.uvalue, is_negative};
+}
+
+bigint bigint::operator+ (const bigint& that) && {
+   return move (*this += that);
+}
+
+bigint bigint::operator- (const bigint& that) && {
+   return move (*this -= that);
+}
+
+bigint bigint::operator* (const bigint& that) && {
+   return move (*this *= that);
+}
+
+bigint bigint::operator/ (const bigint& that) && {
+   return move (*this /= that);
+}
+
+bigint bigint::operator% (const bigint& that) && {
+   return move (*this %= that);
 }
 
 bool bigint::operator== (const bigint& that) const {
@@ -179,8 +146,22 @@ bool bigint::operator< (const bigint& that) const {
                       : uvalue < that.uvalue;
 }
 
+void bigint::append (string& out, unsigned radix) const {
+   if (is_negative) out += '-';
+   uvalue.append_radix (out, radix);
+}
+
+ostream& bigint::write (ostream& out, unsigned radix) const {
+   // The sign counts against the line width, so wrap the whole
+   // text rather than letting ubigint wrap just the digits.
+   static thread_local string text;
+   text.clear();
+   append (text, radix);
+   wrap_lines (text);
+   return out.write (text.data(), text.size());
+}
+
 ostream& operator<< (ostream& out, const bigint& that) {
-   return out << (that.is_negative ? "-" : "")
-              << that.uvalue;
+   return that.write (out, 10);
 }
 
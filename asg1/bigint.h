@@ -4,6 +4,7 @@
 #include <exception>
 #include <iostream>
 #include <limits>
+#include <string_view>
 #include <utility>
 using namespace std;
 
@@ -13,27 +14,70 @@ using namespace std;
 
 class bigint {
    friend ostream& operator<< (ostream&, const bigint&);
+   friend bigint powmod (const bigint&, const bigint&, const bigint&);
+   friend bigint isqrt (const bigint&);
+   friend bigint gcd (const bigint&, const bigint&);
    private:
       ubigint uvalue;
       bool is_negative {false};
+      bigint& add_signed (const bigint&, bool negate);
+      void normalize() { if (uvalue.is_zero()) is_negative = false; }
    public:
 
       bigint() = default; // Needed or will be suppressed.
       bigint (long);
       bigint (const ubigint&, bool is_negative = false);
-      explicit bigint (const string&);
+      // dc syntax: _ for minus, and A-F as digits in any radix.
+      explicit bigint (string_view, unsigned radix = 10);
 
       bigint operator+() const;
       bigint operator-() const;
 
-      bigint operator+ (const bigint&) const;
-      bigint operator- (const bigint&) const;
-      bigint operator* (const bigint&) const;
-      bigint operator/ (const bigint&) const;
-      bigint operator% (const bigint&) const;
+      //
+      // In-place arithmetic.  Division truncates toward zero and the
+      // remainder takes the sign of the dividend, as in dc.  Shifts
+      // move the magnitude and leave the sign alone.
+      //
+      bigint& operator+= (const bigint&);
+      bigint& operator-= (const bigint&);
+      bigint& operator*= (const bigint&);
+      bigint& operator/= (const bigint&);
+      bigint& operator%= (const bigint&);
+      bigint& operator<<= (size_t bits);
+      bigint& operator>>= (size_t bits);
+
+      bool is_zero() const { return uvalue.is_zero(); }
+      bool is_odd() const { return uvalue.is_odd(); }
+
+      // Binary digits of the magnitude, bit 0 the least significant,
+      // and the low 64 of them as a word.
+      size_t bit_length() const { return uvalue.bit_length(); }
+      bool bit (size_t index) const { return uvalue.bit (index); }
+      uint64_t low_word() const { return uvalue.low_word(); }
+
+      //
+      // The binary operators are overloaded on the value category
+      // of the left operand: a temporary on the left is updated in
+      // place and moved into the result instead of being copied.
+      //
+      bigint operator+ (const bigint&) const&;
+      bigint operator- (const bigint&) const&;
+      bigint operator* (const bigint&) const&;
+      bigint operator/ (const bigint&) const&;
+      bigint operator% (const bigint&) const&;
+      bigint operator+ (const bigint&) &&;
+      bigint operator- (const bigint&) &&;
+      bigint operator* (const bigint&) &&;
+      bigint operator/ (const bigint&) &&;
+      bigint operator% (const bigint&) &&;
 
       bool operator== (const bigint&) const;
       bool operator<  (const bigint&) const;
+
+      // Appends the number as dc prints it in the radix, less the
+      // line breaks, which write adds; operator<< is radix 10.
+      void append (string& out, unsigned radix) const;
+      ostream& write (ostream&, unsigned radix) const;
 };
 
 #endif
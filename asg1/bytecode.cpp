@@ -0,0 +1,436 @@
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+using namespace std;
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bytecode.h"
+#include "debug.h"
+#include "profile.h"
+#include "scanner.h"
+#include "util.h"
+#include "workpool.h"
+
+script_text::script_text (int fd) {
+   struct stat status;
+   if (fstat (fd, &status) == 0 and S_ISREG (status.st_mode)
+       and status.st_size > 0) {
+      void* mapping = mmap (nullptr, status.st_size, PROT_READ,
+                            MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED) {
+         data_ = static_cast<const char*> (mapping);
+         size_ = status.st_size;
+         mapped_ = true;
+         return;
+      }
+   }
+   const size_t CHUNK = 1 << 16;
+   for (;;) {
+      size_t used = buffer_.size();
+      buffer_.resize (used + CHUNK);
+      ssize_t bytes = read (fd, buffer_.data() + used, CHUNK);
+      if (bytes < 0 and errno != EINTR) {
+         throw runtime_error (strerror (errno));
+      }
+      buffer_.resize (used + max<ssize_t> (bytes, 0));
+      if (bytes == 0) break;
+   }
+   data_ = buffer_.data();
+   size_ = buffer_.size();
+}
+
+script_text::~script_text() {
+   if (mapped_) munmap (const_cast<char*> (data_), size_);
+}
+
+//
+// Largest number of decimal digits that always fits in a word.
+//
+static const size_t WORD_DIGITS = 19;
+
+const decimal& ydc_value::number() const& {
+   if (is_string()) throw ydc_exn ("non-numeric value");
+   return number_;
+}
+
+decimal ydc_value::number() && {
+   if (is_string()) throw ydc_exn ("non-numeric value");
+   return move (number_);
+}
+
+unsigned ydc_settings::input_radix = 10;
+unsigned ydc_settings::output_radix = 10;
+size_t ydc_settings::scale = 0;
+
+ostream& operator<< (ostream& out, const ydc_value& value) {
+   if (value.is_string()) return out << value.string_->text();
+   return value.number_.write (out, ydc_settings::output_radix);
+}
+
+void need_numbers (value_stack& stack, size_t count) {
+   if (stack.size() < count) throw ydc_exn ("stack empty");
+   auto value = stack.begin();
+   for (size_t index = 0; index < count; ++index, ++value) {
+      if (value->is_string()) throw ydc_exn ("non-numeric value");
+   }
+}
+
+const program& macro::code (lookup_t lookup) const {
+   call_once (compiled_, [&] {
+      code_ = compile (text_.data(), text_.data() + text_.size(),
+                       lookup);
+   });
+   return code_;
+}
+
+void compile (const token& lexeme, program& prog, lookup_t lookup) {
+   string_view lexinfo = lexeme.lexinfo;
+   switch (lexeme.symbol) {
+      case tsymbol::NUMBER: {
+         bool negative = lexinfo[0] == '_';
+         string_view digits = lexinfo.substr (negative);
+         instruction step {opcode::PUSH_CONSTANT, 0, nullptr, 0};
+         if (digits.size() <= WORD_DIGITS
+             and digits.find_first_of ("ABCDEF.") == digits.npos) {
+            for (char digit: digits) {
+               step.operand = step.operand * 10 + (digit - '0');
+            }
+            step.op = negative and step.operand != 0
+                    ? opcode::PUSH_NEGATIVE : opcode::PUSH_WORD;
+         }else {
+            step.operand = prog.constants.size();
+            prog.constants.emplace_back (lexinfo);
+            prog.literals.emplace_back (lexinfo);
+         }
+         prog.code.push_back (step);
+         break;
+      }
+      case tsymbol::STRING:
+         prog.code.push_back ({opcode::PUSH_STRING, '[', nullptr,
+                               prog.strings.size()});
+         prog.strings.push_back (make_shared<const macro> (lexinfo));
+         break;
+      case tsymbol::OPERATOR: {
+         char oper = lexinfo[0];
+         instruction step {opcode::CALL, oper, nullptr, 0};
+         switch (lexinfo.size() == 1 ? 0 : oper) {
+            case 's': step.op = opcode::STORE; break;
+            case 'l': step.op = opcode::LOAD; break;
+            case 'S': step.op = opcode::PUSH_REGISTER; break;
+            case 'L': step.op = opcode::POP_REGISTER; break;
+            case '<': case '>': case '=':
+               step.op = opcode::EXECUTE_IF;
+               break;
+            case '!':
+               if (lexinfo.size() == 3) {
+                  step.op = opcode::EXECUTE_UNLESS;
+                  step.oper = lexinfo[1];
+               }
+               break;
+            case 0:
+               if (oper == 'x') step.op = opcode::EXECUTE;
+               if (oper == 'q' or oper == 'Q') step.op = opcode::QUIT;
+               break;
+         }
+         if (step.op == opcode::CALL) {
+            step.function = lookup (oper);
+         }else if (lexinfo.size() > 1) {
+            step.operand = static_cast<unsigned char> (lexinfo.back());
+         }
+         prog.code.push_back (step);
+         break;
+      }
+      case tsymbol::SCANEOF:
+         break;
+   }
+}
+
+program compile (const char* begin, const char* end, lookup_t lookup) {
+   program result;
+   scanner input (begin, end);
+   for (;;) {
+      token lexeme = input.scan();
+      if (lexeme.symbol == tsymbol::SCANEOF) break;
+      compile (lexeme, result, lookup);
+   }
+   DEBUGF ('b', result.code.size() << " instructions, "
+           << result.constants.size() << " constants, "
+           << result.strings.size() << " strings");
+   return result;
+}
+
+static string register_name (uint64_t reg) {
+   return "'"s + static_cast<char> (reg) + "' (" + octal (reg) + ")";
+}
+
+void machine::execute (const ydc_value& value) {
+   if (not value.is_string()) {
+      stack.push (value);
+      return;
+   }
+   shared_ptr<const macro> body = value.string();
+   const program& code = body->code (lookup);
+   size_t levels = 1;
+   if (not frames.empty()
+       and frames.back().next == frames.back().code->code.size()) {
+      levels += frames.back().levels;
+      frames.pop_back();
+   }
+   frames.push_back ({&code, 0, move (body), levels});
+}
+
+//
+// Leaves that many levels of macros.  The callers that a frame
+// replaced were all at their ends, so leaving part of a frame's
+// levels leaves the whole frame.  Returns false if there were fewer
+// levels than that, and so the top level would be left too.
+//
+bool machine::leave (size_t levels) {
+   while (levels > 0 and not frames.empty()) {
+      levels -= min (levels, frames.back().levels);
+      frames.pop_back();
+   }
+   return levels == 0;
+}
+
+void machine::quit (char oper) {
+   if (oper == 'q') {
+      if (not leave (2)) throw ydc_quit();
+      return;
+   }
+   need_numbers (stack, 1);
+   bigint count = stack.top().number().integer();
+   if (count < bigint (1)) {
+      throw ydc_exn ("Q command requires a number >= 1");
+   }
+   stack.pop_top();
+   leave (count.bit_length() < 64 ? count.low_word() : SIZE_MAX);
+}
+
+void machine::step (const program& prog, const instruction& current) {
+   switch (current.op) {
+      case opcode::PUSH_WORD:
+      case opcode::PUSH_NEGATIVE: {
+         bool negative = current.op == opcode::PUSH_NEGATIVE;
+         if (ydc_settings::input_radix == 10) {
+            stack.emplace (bigint (ubigint (current.operand),
+                                   negative));
+         }else {
+            bigint value (std::to_string (current.operand),
+                          ydc_settings::input_radix);
+            stack.emplace (negative ? -value : value);
+         }
+         break;
+      }
+      case opcode::PUSH_CONSTANT:
+         if (ydc_settings::input_radix == 10) {
+            stack.push (prog.constants[current.operand]);
+         }else {
+            stack.emplace (decimal (prog.literals[current.operand],
+                                    ydc_settings::input_radix));
+         }
+         break;
+      case opcode::PUSH_STRING:
+         stack.push (prog.strings[current.operand]);
+         break;
+      case opcode::CALL:
+         if (profile::enabled) {
+            profile::call (current.function, stack, current.oper);
+         }else {
+            current.function (stack, current.oper);
+         }
+         break;
+      case opcode::EXECUTE:
+         if (stack.empty()) throw ydc_exn ("stack empty");
+         execute (stack.pop_top());
+         break;
+      case opcode::QUIT:
+         quit (current.oper);
+         break;
+      case opcode::STORE: {
+         if (stack.empty()) throw ydc_exn ("stack empty");
+         vector<ydc_value>& reg = registers[current.operand];
+         if (reg.empty()) reg.push_back (stack.pop_top());
+                     else reg.back() = stack.pop_top();
+         break;
+      }
+      case opcode::LOAD: {
+         const vector<ydc_value>& reg = registers[current.operand];
+         if (reg.empty()) {
+            throw ydc_exn ("register "
+                           + register_name (current.operand)
+                           + " is empty");
+         }
+         stack.push (reg.back());
+         break;
+      }
+      case opcode::PUSH_REGISTER:
+         if (stack.empty()) throw ydc_exn ("stack empty");
+         registers[current.operand].push_back (stack.pop_top());
+         break;
+      case opcode::POP_REGISTER: {
+         vector<ydc_value>& reg = registers[current.operand];
+         if (reg.empty()) {
+            throw ydc_exn ("stack register "
+                           + register_name (current.operand)
+                           + " is empty");
+         }
+         stack.push (move (reg.back()));
+         reg.pop_back();
+         break;
+      }
+      case opcode::EXECUTE_IF:
+      case opcode::EXECUTE_UNLESS: {
+         need_numbers (stack, 2);
+         decimal top = stack.pop_top().number();
+         decimal second = stack.pop_top().number();
+         bool holds = current.oper == '<' ? top < second
+                    : current.oper == '>' ? second < top
+                    : top == second;
+         if (holds == (current.op == opcode::EXECUTE_UNLESS)) break;
+         const vector<ydc_value>& reg = registers[current.operand];
+         if (reg.empty()) {
+            throw ydc_exn ("register "
+                           + register_name (current.operand)
+                           + " is empty");
+         }
+         execute (reg.back());
+         break;
+      }
+   }
+}
+
+void machine::run (const program& prog) {
+   const instruction* begin = prog.code.data();
+   run (prog, begin, begin + prog.code.size());
+}
+
+void machine::run (const program& prog, const instruction* begin,
+                   const instruction* end) {
+   frames.clear();
+   for (const instruction* current = begin; current != end;
+        ++current) {
+      try {
+         step (prog, *current);
+      }catch (ydc_exn& exn) {
+         output() << exn.what() << '\n';
+      }
+      while (not frames.empty()) {
+         frame& top = frames.back();
+         if (top.next == top.code->code.size()) {
+            frames.pop_back();
+            continue;
+         }
+         const program& code = *top.code;
+         const instruction& called = code.code[top.next++];
+         try {
+            step (code, called);
+         }catch (ydc_exn& exn) {
+            output() << exn.what() << '\n';
+         }
+      }
+   }
+}
+
+static thread_local ostream* piece_output = nullptr;
+
+ostream& output() {
+   return piece_output == nullptr ? cout : *piece_output;
+}
+
+//
+// True if the program or any string in it, which is all the code
+// it can execute, names a register or sets a radix or the scale.
+//
+static bool shares_state (const program& prog, lookup_t lookup) {
+   for (const instruction& step: prog.code) {
+      switch (step.op) {
+         case opcode::STORE: case opcode::LOAD:
+         case opcode::PUSH_REGISTER: case opcode::POP_REGISTER:
+         case opcode::EXECUTE_IF: case opcode::EXECUTE_UNLESS:
+            return true;
+         case opcode::CALL:
+            if (step.oper == 'i' or step.oper == 'o'
+                or step.oper == 'k') return true;
+            break;
+         default:
+            break;
+      }
+   }
+   for (const auto& string: prog.strings) {
+      if (shares_state (string->code (lookup), lookup)) return true;
+   }
+   return false;
+}
+
+//
+// piece -
+//    One stretch of the program, run by calling it, with its own
+//    stack and output.  The output stream it replaces is restored
+//    after, rather than cleared.
+//
+struct piece {
+   const program* prog;
+   lookup_t lookup;
+   const instruction* begin;
+   const instruction* end;
+   ostringstream out;
+   bool quit {false};
+   void operator()() {
+      ostream* saved = piece_output;
+      piece_output = &out;
+      value_stack stack;
+      try {
+         machine (stack, lookup).run (*prog, begin, end);
+      }catch (ydc_quit&) {
+         quit = true;
+      }
+      piece_output = saved;
+   }
+};
+
+void run_pieces (const program& prog, lookup_t lookup) {
+   if (shares_state (prog, lookup)) {
+      DEBUGF ('b', "registers or settings used, running in order");
+      value_stack stack;
+      machine (stack, lookup).run (prog);
+      return;
+   }
+   vector<const instruction*> bounds {prog.code.data()};
+   for (const instruction& step: prog.code) {
+      if (step.op == opcode::CALL and step.oper == 'c') {
+         bounds.push_back (&step + 1);
+      }
+   }
+   bounds.push_back (prog.code.data() + prog.code.size());
+   DEBUGF ('b', bounds.size() - 1 << " pieces");
+   // Enough pieces at a time to keep every thread busy while one
+   // is slow, but not so many that their outputs pile up.
+   size_t batch = 4 * workpool::threads();
+   for (size_t first = 0; first + 1 < bounds.size(); first += batch) {
+      size_t count = min (batch, bounds.size() - 1 - first);
+      vector<piece> pieces (count);
+      vector<workpool::task_ref> tasks;
+      for (size_t index = 0; index < count; ++index) {
+         piece& part = pieces[index];
+         part.prog = &prog;
+         part.lookup = lookup;
+         part.begin = bounds[first + index];
+         part.end = bounds[first + index + 1];
+         tasks.emplace_back (part);
+      }
+      workpool::fork_join (tasks.data(), tasks.size());
+      for (const piece& part: pieces) {
+         cout << part.out.str();
+         if (part.quit) throw ydc_quit();
+      }
+   }
+}
+
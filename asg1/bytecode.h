@@ -0,0 +1,210 @@
+//
+// bytecode -
+//    Compiled execution for ydc.  Script text is tokenized a single
+//    time by the scanner into a flat array of instructions, which a
+//    machine then runs with no scanning, no string building, and no
+//    operator lookup.  Batch mode (-b) compiles the whole script at
+//    once; interactive mode compiles and runs a token at a time.
+//
+// script_text -
+//    The bytes of a script read from a file descriptor, mapped into
+//    memory when it is a regular file and read into a buffer
+//    otherwise.  Throws runtime_error if it cannot be read.
+//
+// ydc_value -
+//    An element of the operand stack or of a register: a number,
+//    kept as a decimal with its scale, or a string.  Strings are
+//    shared rather than copied, so d, s, and l cost the same for a
+//    long macro as for a short one.  number() throws ydc_exn for a
+//    string.
+//
+// instruction -
+//    Pushes a number or a string, calls an operator function, or is
+//    one of the operations the machine does itself: x, q, and the
+//    register and conditional operations.  Decimal integers that
+//    fit in a word are kept in the instruction itself, others and
+//    strings in the program's constant pools.  A number's value is
+//    worked out as decimal when it is compiled.  If it is not in the
+//    instruction, a view of its text is kept too, for when the input
+//    radix is not 10 when it runs.  For the register operations the
+//    operand is the register.
+//
+// macro -
+//    The text of a string, and the program compiled from it the
+//    first time it is executed.  The program is kept with the text,
+//    so a loop is scanned once however often it runs.
+//
+// compile -
+//    Translates script text to a program, or appends one token to a
+//    program.  lookup gives the function for an operator character,
+//    and is expected to return one that reports the operator as
+//    unimplemented when there is none.  The program views the text
+//    of its number literals rather than copying it, so the text
+//    must outlive the program: the script in batch mode, the
+//    macro's own text, or the token until it has run.
+//
+// machine -
+//    Runs programs on a stack and holds the registers.  Macros run
+//    on a stack of frames rather than by recursion, and a macro
+//    executed as the last instruction of another replaces it, so a
+//    loop written as a macro that reexecutes itself runs in
+//    constant space.  The replacing frame counts the levels it
+//    stands for, so that q and Q leave as many macros as dc would.
+//    A ydc_exn thrown by an instruction is printed and execution
+//    continues with the next one.  q leaves the current macro and
+//    its caller, and throws ydc_quit when that would leave the top
+//    level.  Q pops a count and leaves that many macros, but never
+//    the top level.
+//
+// output -
+//    The stream that printing operators and error messages write
+//    to: cout, or a piece's own buffer while run_pieces runs it.
+//
+// run_pieces -
+//    Runs a program split at each top-level c as independent
+//    pieces, several at once on the workpool, each with its own
+//    stack, registers, and output buffer.  Outputs are written in
+//    the order of the pieces, a batch at a time.  Since c clears the
+//    stack, pieces share nothing but the registers and settings, so
+//    a program that uses a register or sets a radix or the scale
+//    runs in order on a single machine instead.  Throws ydc_quit
+//    after the output of a piece that quits.
+//
+// ydc_settings -
+//    The radices that numbers are read and printed in and the
+//    number of fraction digits that arithmetic keeps, dc's i, o,
+//    and k, shared by every machine.
+//
+
+#ifndef __BYTECODE_H__
+#define __BYTECODE_H__
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+#include "bigint.h"
+#include "decimal.h"
+#include "iterstack.h"
+
+class script_text {
+   private:
+      const char* data_ {nullptr};
+      size_t size_ {0};
+      bool mapped_ {false};
+      vector<char> buffer_;
+   public:
+      explicit script_text (int fd);
+      script_text (const script_text&) = delete;
+      script_text& operator= (const script_text&) = delete;
+      ~script_text();
+      const char* begin() const { return data_; }
+      const char* end() const { return data_ + size_; }
+};
+
+class macro;
+
+class ydc_value {
+   friend ostream& operator<< (ostream&, const ydc_value&);
+   private:
+      decimal number_;
+      shared_ptr<const macro> string_;
+   public:
+      ydc_value (const decimal& number): number_(number) {}
+      ydc_value (decimal&& number): number_(move (number)) {}
+      ydc_value (bigint&& number): number_(move (number)) {}
+      ydc_value (shared_ptr<const macro> string):
+                 string_(move (string)) {}
+      bool is_string() const { return string_ != nullptr; }
+      const shared_ptr<const macro>& string() const { return string_; }
+      const decimal& number() const&;
+      decimal number() &&;
+};
+
+using value_stack = iterstack<ydc_value>;
+using function_t = void (*)(value_stack&, const char);
+using lookup_t = function_t (*) (char);
+
+//
+// Throws ydc_exn unless the top count elements of the stack are
+// numbers, so that an operator can check before it pops.
+//
+void need_numbers (value_stack&, size_t count);
+
+enum class opcode: uint8_t {PUSH_WORD, PUSH_NEGATIVE, PUSH_CONSTANT,
+                            PUSH_STRING, CALL, EXECUTE, QUIT,
+                            STORE, LOAD, PUSH_REGISTER, POP_REGISTER,
+                            EXECUTE_IF, EXECUTE_UNLESS};
+
+struct instruction {
+   opcode op;
+   char oper;
+   function_t function;
+   uint64_t operand;
+};
+
+struct ydc_settings {
+   static unsigned input_radix;
+   static unsigned output_radix;
+   static size_t scale;
+};
+
+struct program {
+   vector<instruction> code;
+   vector<decimal> constants;
+   vector<string_view> literals;
+   vector<shared_ptr<const macro>> strings;
+};
+
+class macro {
+   private:
+      string text_;
+      mutable once_flag compiled_;
+      mutable program code_;
+   public:
+      explicit macro (string_view text): text_(text) {}
+      const string& text() const { return text_; }
+      const program& code (lookup_t) const;
+};
+
+struct token;
+program compile (const char* begin, const char* end, lookup_t);
+void compile (const token&, program&, lookup_t);
+
+class ydc_quit: public exception {};
+
+class machine {
+   private:
+      struct frame {
+         const program* code;
+         size_t next;
+         shared_ptr<const macro> owner;
+         size_t levels;
+      };
+      value_stack& stack;
+      lookup_t lookup;
+      array<vector<ydc_value>,256> registers;
+      vector<frame> frames;
+      void execute (const ydc_value&);
+      bool leave (size_t levels);
+      void quit (char oper);
+      void step (const program&, const instruction&);
+   public:
+      machine (value_stack& stack, lookup_t lookup):
+               stack(stack), lookup(lookup) {}
+      void run (const program&);
+      void run (const program&, const instruction* begin,
+                const instruction* end);
+};
+
+ostream& output();
+void run_pieces (const program&, lookup_t);
+
+#endif
+
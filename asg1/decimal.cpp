@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+using namespace std;
+
+#include "decimal.h"
+#include "libfns.h"
+#include "ubigint.h"
+
+static bigint ten_to (size_t power) {
+   return pow (bigint (10), bigint (static_cast<long> (power)));
+}
+
+// The same value in units that many digits smaller.
+static bigint widen (bigint units, size_t digits) {
+   if (digits > 0) units *= ten_to (digits);
+   return units;
+}
+
+// Units that many digits larger, truncated toward zero.
+static bigint narrow (bigint units, size_t digits) {
+   if (digits > 0) units /= ten_to (digits);
+   return units;
+}
+
+decimal::decimal (string_view text, unsigned radix) {
+   size_t point = text.find ('.');
+   if (point == text.npos) {
+      units = bigint (text, radix);
+      return;
+   }
+   bool negative = text.size() > 0 and text[0] == '_';
+   string_view whole = text.substr (negative, point - negative);
+   string_view fraction = text.substr (point + 1);
+   scale_ = fraction.size();
+   bigint part (fraction, radix);
+   if (radix != 10) {
+      // The digits are a count of radix^-scale; convert them to
+      // units of 10^-scale.
+      part = part * ten_to (scale_)
+           / pow (bigint (radix), bigint (static_cast<long> (scale_)));
+   }
+   units = widen (bigint (whole, radix), scale_) + part;
+   if (negative) units = -units;
+}
+
+bigint decimal::integer() const {
+   return narrow (units, scale_);
+}
+
+decimal decimal::rescaled (size_t scale) const {
+   if (scale >= scale_) return {widen (units, scale - scale_), scale};
+   return {narrow (units, scale_ - scale), scale};
+}
+
+//
+// The inline operators handle equal scales; this lines up unequal
+// ones first.
+//
+decimal& decimal::add (const decimal& that, bool subtract) {
+   if (scale_ < that.scale_) {
+      units = widen (move (units), that.scale_ - scale_);
+      scale_ = that.scale_;
+      if (subtract) units -= that.units;
+               else units += that.units;
+   }else {
+      bigint aligned = widen (that.units, scale_ - that.scale_);
+      if (subtract) units -= aligned;
+               else units += aligned;
+   }
+   return *this;
+}
+
+//
+// dc keeps every fraction digit of a product up to the larger of
+// the scale and the operands' own scales.
+//
+decimal multiply (decimal left, const decimal& right, size_t scale) {
+   size_t exact = left.scale_ + right.scale_;
+   size_t kept = min (exact, max ({scale, left.scale_, right.scale_}));
+   left.units *= right.units;
+   left.units = narrow (move (left.units), exact - kept);
+   left.scale_ = kept;
+   return left;
+}
+
+//
+// The quotient's units are left * 10^(scale + right's scale - left's
+// scale) / right, all in units, with the power of ten moved to the
+// divisor when it is negative.
+//
+decimal divide (decimal left, const decimal& right, size_t scale) {
+   size_t shift = scale + right.scale_;
+   if (shift >= left.scale_) {
+      left.units = widen (move (left.units), shift - left.scale_);
+      left.units /= right.units;
+   }else {
+      left.units /= widen (right.units, left.scale_ - shift);
+   }
+   left.scale_ = scale;
+   return left;
+}
+
+//
+// left - right * (left / right), the quotient at the given scale,
+// and so exact at the larger of left's scale and scale plus right's.
+//
+decimal remainder (decimal left, const decimal& right, size_t scale) {
+   if (scale == 0 and left.scale_ == 0 and right.scale_ == 0) {
+      left.units %= right.units;
+      return left;
+   }
+   decimal product = divide (left, right, scale);
+   product.units *= right.units;
+   product.scale_ += right.scale_;
+   left -= product;
+   return left;
+}
+
+//
+// The exact power has the base's scale times the exponent, and dc
+// keeps up to the larger of the scale and the base's own.
+//
+decimal power (decimal base, const bigint& exponent, size_t scale) {
+   bool negative = exponent < bigint (0);
+   if (base.scale_ == 0 and (scale == 0 or not negative)) {
+      base.units = pow (move (base.units), exponent);
+      return base;
+   }
+   bigint count = negative ? -exponent : exponent;
+   size_t exact = base.scale_ * count.low_word();
+   bigint raised = pow (move (base.units), count);
+   if (negative) return {ten_to (scale + exact) / raised, scale};
+   size_t kept = min (exact, max (scale, base.scale_));
+   return {narrow (move (raised), exact - kept), kept};
+}
+
+decimal square_root (const decimal& number, size_t scale) {
+   size_t kept = max (scale, number.scale_);
+   return {isqrt (widen (number.units, 2 * kept - number.scale_)),
+           kept};
+}
+
+bool operator== (const decimal& left, const decimal& right) {
+   if (left.scale_ == right.scale_) return left.units == right.units;
+   size_t scale = max (left.scale_, right.scale_);
+   return left.rescaled (scale).units == right.rescaled (scale).units;
+}
+
+bool operator< (const decimal& left, const decimal& right) {
+   if (left.scale_ == right.scale_) return left.units < right.units;
+   size_t scale = max (left.scale_, right.scale_);
+   return left.rescaled (scale).units < right.rescaled (scale).units;
+}
+
+//
+// In radix 10 the point goes straight into the digits of the units.
+// In other radices the integer and fraction are written separately,
+// the fraction with as many digits as it takes for the radix's
+// power to reach 10^scale, as dc does.
+//
+ostream& decimal::write (ostream& out, unsigned radix) const {
+   if (scale_ == 0) return units.write (out, radix);
+   static thread_local string text;
+   text.clear();
+   if (units.is_zero()) {
+      text += '0';
+   }else if (radix == 10) {
+      units.append (text, 10);
+      size_t sign = text[0] == '-';
+      size_t digits = text.size() - sign;
+      if (digits < scale_) text.insert (sign, scale_ - digits, '0');
+      text.insert (text.size() - scale_, 1, '.');
+   }else {
+      bigint whole = integer();
+      bigint fraction = units - widen (whole, scale_);
+      if (units < bigint (0)) {
+         text += '-';
+         whole = -whole;
+         fraction = -fraction;
+      }
+      if (not whole.is_zero()) whole.append (text, radix);
+      text += '.';
+      bigint one = ten_to (scale_);
+      bigint place (1);
+      size_t count = 0;
+      for (; place < one; ++count) place *= bigint (radix);
+      size_t start = text.size();
+      bigint value = fraction * place / one;
+      if (not value.is_zero()) value.append (text, radix);
+      size_t width = radix <= 16 ? 1
+                   : std::to_string (radix - 1).size() + 1;
+      string zero = radix <= 16 ? "0" : " " + string (width - 1, '0');
+      for (size_t digits = (text.size() - start) / width;
+           digits < count; ++digits) text.insert (start, zero);
+      // dc puts no space between the point and the first digit.
+      if (radix > 16) text.erase (start, 1);
+   }
+   wrap_lines (text);
+   return out.write (text.data(), text.size());
+}
+
+ostream& operator<< (ostream& out, const decimal& that) {
+   return that.write (out, 10);
+}
@@ -0,0 +1,91 @@
+#ifndef __DECIMAL_H__
+#define __DECIMAL_H__
+
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+using namespace std;
+
+#include "bigint.h"
+#include "relops.h"
+
+//
+// decimal -
+//    A fixed-point number the way dc keeps one: a count of units of
+//    10^-scale, so 1.50 is 150 units at scale 2.  Addition,
+//    subtraction, and comparison are exact, and line the scales up
+//    first.  Numbers at scale 0 are plain bigints and take the
+//    bigint arithmetic directly.
+//
+//    The literal constructor takes dc syntax, with _ for minus, A-F
+//    as digits, and an optional point.  The scale is the number of
+//    digits after the point, whatever the radix.  integer() is the
+//    value truncated toward zero.  write prints as dc does, with no
+//    zero before the point.
+//
+// multiply, divide, remainder, power, square_root -
+//    dc's *, /, %, ^, and v, keeping the number of fraction digits
+//    that dc's rules give for the scale register k (passed as
+//    scale), and truncating toward zero.  Each widens its operand
+//    by a power of ten once and then does a single integer
+//    operation, so the scaled result costs one division, not one
+//    per digit.  The exponent of a power is an integer; a negative
+//    one gives the reciprocal at the given scale.  The left operand
+//    is taken by value so that callers can move it in.
+//
+
+class decimal {
+   friend bool operator== (const decimal&, const decimal&);
+   friend bool operator<  (const decimal&, const decimal&);
+   private:
+      bigint units;
+      size_t scale_ {0};
+      decimal& add (const decimal&, bool subtract);
+   public:
+      decimal() = default;
+      decimal (const bigint& value, size_t scale = 0):
+               units(value), scale_(scale) {}
+      decimal (bigint&& value, size_t scale = 0):
+               units(move (value)), scale_(scale) {}
+      decimal (long value): units(value) {}
+      explicit decimal (string_view, unsigned radix = 10);
+
+      size_t scale() const { return scale_; }
+      bool is_zero() const { return units.is_zero(); }
+      size_t bit_length() const { return units.bit_length(); }
+      bigint integer() const;
+      decimal rescaled (size_t scale) const;
+
+      decimal& operator+= (const decimal& that) {
+         if (scale_ != that.scale_) return add (that, false);
+         units += that.units;
+         return *this;
+      }
+      decimal& operator-= (const decimal& that) {
+         if (scale_ != that.scale_) return add (that, true);
+         units -= that.units;
+         return *this;
+      }
+
+      ostream& write (ostream&, unsigned radix) const;
+
+      friend decimal multiply (decimal, const decimal&, size_t scale);
+      friend decimal divide (decimal, const decimal&, size_t scale);
+      friend decimal remainder (decimal, const decimal&, size_t scale);
+      friend decimal power (decimal, const bigint& exponent,
+                            size_t scale);
+      friend decimal square_root (const decimal&, size_t scale);
+};
+
+decimal multiply (decimal, const decimal&, size_t scale);
+decimal divide (decimal, const decimal&, size_t scale);
+decimal remainder (decimal, const decimal&, size_t scale);
+decimal power (decimal, const bigint& exponent, size_t scale);
+decimal square_root (const decimal&, size_t scale);
+
+bool operator== (const decimal&, const decimal&);
+bool operator<  (const decimal&, const decimal&);
+ostream& operator<< (ostream&, const decimal&);
+
+#endif
+
@@ -14,11 +14,17 @@
 //
 // Any underlying container which supports the necessary operations
 // could be used, such as vector, list, or deque.
+//
+// Values are moved in and out where possible: push has an rvalue
+// overload, emplace constructs in place, and pop_top moves the top
+// element out before popping it, so that large elements need not
+// be copied to be used.
 // 
 
 #ifndef __ITERSTACK_H__
 #define __ITERSTACK_H__
 
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -29,6 +35,7 @@ class iterstack: private vector<value_type> {
       using stack_t::crbegin;
       using stack_t::crend;
       using stack_t::push_back;
+      using stack_t::emplace_back;
       using stack_t::pop_back;
       using stack_t::back;
       using const_iterator = typename stack_t::const_reverse_iterator;
@@ -39,8 +46,18 @@ class iterstack: private vector<value_type> {
       inline const_iterator begin() {return crbegin();}
       inline const_iterator end() {return crend();}
       inline void push (const value_type& value) {push_back (value);}
+      inline void push (value_type&& value) {push_back (move (value));}
+      template <typename... args_t>
+      inline void emplace (args_t&&... args) {
+         emplace_back (forward<args_t> (args)...);
+      }
       inline void pop() {pop_back();}
       inline const value_type& top() const {return back();}
+      inline value_type pop_top() {
+         value_type value = move (back());
+         pop_back();
+         return value;
+      }
 };
 
 #endif
@@ -1,33 +1,246 @@
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+using namespace std;
+
 #include "libfns.h"
 
 //
-// This algorithm would be more efficient with operators
-// *=, /=2, and is_odd.  But we leave it here.
+// window_bits -
+//    Width of the sliding window for an exponent of this many bits,
+//    balancing the 2^(k-1) odd powers precomputed against the
+//    multiplications saved while scanning.
+//
+
+static size_t window_bits (size_t exponent_bits) {
+   static const size_t limits[] {8, 24, 80, 240, 672};
+   size_t width = 1;
+   for (size_t limit: limits) {
+      if (exponent_bits <= limit) break;
+      ++width;
+   }
+   return width;
+}
+
+//
+// window_pow -
+//    Left-to-right sliding window exponentiation of a positive
+//    exponent.  The exponent's bits are read straight from its
+//    representation; runs of zeros cost one squaring per bit, and
+//    each window of up to k bits ending in a one costs k squarings
+//    and a multiplication by one of the precomputed odd powers of
+//    the base.
 //
 
-bigint pow (const bigint& base_arg, const bigint& exponent_arg) {
-   bigint base (base_arg);
-   bigint exponent (exponent_arg);
+static bigint window_pow (const bigint& base, const bigint& exponent) {
+   size_t bits = exponent.bit_length();
+   size_t width = window_bits (bits);
+   vector<bigint> odd_powers {base};
+   if (width > 1) {
+      bigint square = odd_powers[0] * odd_powers[0];
+      for (size_t count = 1; count < size_t (1) << (width - 1);
+           ++count) {
+         odd_powers.push_back (odd_powers.back() * square);
+      }
+   }
+
+   bigint result (1);
+   for (size_t top = bits; top > 0; ) {
+      if (not exponent.bit (top - 1)) {
+         result *= result;
+         --top;
+         continue;
+      }
+      size_t low = top > width ? top - width : 0;
+      while (not exponent.bit (low)) ++low;
+      size_t window = 0;
+      for (size_t index = top; index > low; --index) {
+         window = window << 1 | exponent.bit (index - 1);
+         result *= result;
+      }
+      result *= odd_powers[window >> 1];
+      top = low;
+   }
+   return result;
+}
+
+//
+// The cache is a list in order of use, most recent first, and an
+// index into it by base and exponent, all under one lock; a power
+// is computed outside the lock, so two threads that miss on the
+// same power both compute it and the second store is dropped.
+// Powers estimated below CACHE_MIN_BITS are quicker to compute
+// than to look up, and are not kept.
+//
+
+static const size_t CACHE_MIN_BITS = 2048;
+
+using power_key = pair<bigint,uint64_t>;
+struct cached_power {
+   power_key key;
+   bigint value;
+   size_t bytes;
+};
+
+static mutex cache_lock;
+static size_t cache_capacity = size_t (16) << 20;
+static list<cached_power> cache_order;
+static map<power_key,list<cached_power>::iterator> cache_index;
+static pow_cache::counters cache_counts {};
+
+static void cache_trim() {
+   while (cache_counts.bytes > cache_capacity) {
+      const cached_power& oldest = cache_order.back();
+      cache_counts.bytes -= oldest.bytes;
+      cache_index.erase (oldest.key);
+      cache_order.pop_back();
+      --cache_counts.entries;
+   }
+}
+
+static bool cache_find (const power_key& key, bigint& result) {
+   lock_guard<mutex> guard (cache_lock);
+   if (cache_capacity == 0) return false;
+   auto found = cache_index.find (key);
+   if (found == cache_index.end()) {
+      ++cache_counts.misses;
+      return false;
+   }
+   ++cache_counts.hits;
+   cache_order.splice (cache_order.begin(), cache_order,
+                       found->second);
+   result = found->second->value;
+   return true;
+}
+
+static void cache_store (power_key&& key, const bigint& value) {
+   size_t bytes = sizeof (cached_power)
+                + (key.first.bit_length() + value.bit_length()) / 8;
+   lock_guard<mutex> guard (cache_lock);
+   if (bytes > cache_capacity or cache_index.count (key) > 0) return;
+   cache_order.push_front ({move (key), value, bytes});
+   cache_index.emplace (cache_order.front().key, cache_order.begin());
+   cache_counts.bytes += bytes;
+   ++cache_counts.entries;
+   cache_trim();
+}
+
+void pow_cache::set_capacity (size_t bytes) {
+   lock_guard<mutex> guard (cache_lock);
+   cache_capacity = bytes;
+   cache_trim();
+}
+
+pow_cache::counters pow_cache::statistics() {
+   lock_guard<mutex> guard (cache_lock);
+   return cache_counts;
+}
+
+ostream& operator<< (ostream& out, const pow_cache::counters& stats) {
+   return out << "pow cache: " << stats.hits << " hits, "
+              << stats.misses << " misses, "
+              << stats.entries << " entries, "
+              << stats.bytes << " bytes";
+}
+
+//
+// pow -
+//    A power of two is built directly as a shift, and a power of
+//    ten as the power of five shifted, which is a third smaller to
+//    compute.  Other large powers go through the cache to
+//    window_pow.  The arguments are taken by value so that callers
+//    can move operands in.  A negative exponent gives 1/base^n
+//    truncated toward zero, as dc does at scale 0.
+//
+
+bigint pow (bigint base, bigint exponent) {
    static const bigint ZERO (0);
    static const bigint ONE (1);
-   static const bigint TWO (2);
    DEBUGF ('^', "base = " << base << ", exponent = " << exponent);
-   if (base == ZERO) return ZERO;
-   bigint result = ONE;
+   size_t bits = exponent.bit_length();
+   if (bits == 0) return ONE;
+   if (base.is_zero()) return ZERO;
    if (exponent < ZERO) {
       base = ONE / base;
-      exponent = - exponent;
-   }
-   while (exponent > ZERO) {
-      if (exponent % TWO == ONE) {
-         result = result * base;
-         exponent = exponent - 1;
-      }else {
-         base = base * base;
-         exponent = exponent / 2;
-      }
+      if (base.is_zero()) return ZERO;
+   }
+   bool negative = base < ZERO and exponent.is_odd();
+   size_t base_bits = base.bit_length();
+   uint64_t word = base.low_word();
+   uint64_t count = exponent.low_word();
+
+   bigint result;
+   if (base_bits <= 64 and (word & (word - 1)) == 0
+       and (base_bits == 1 or bits <= 58)) {
+      result = ONE;
+      result <<= (base_bits - 1) * count;
+      if (negative) result = -result;
+      DEBUGF ('^', "result = " << result);
+      return result;
+   }
+   bool cached = bits <= 32 and base_bits * count >= CACHE_MIN_BITS;
+   power_key key;
+   if (cached) {
+      key = {move (base), count};
+      if (cache_find (key, result)) return result;
+   }
+   const bigint& raised = cached ? key.first : base;
+   if (base_bits == 4 and word == 10 and bits <= 58) {
+      result = window_pow (bigint (5), exponent);
+      result <<= count;
+      if (negative) result = -result;
+   }else {
+      result = window_pow (raised, exponent);
+   }
+   if (cached) cache_store (move (key), result);
+   DEBUGF ('^', "result = " << result);
+   return result;
+}
+
+//
+// powmod -
+//    base^exponent % modulus without forming the power, as dc's |
+//    command.  The result has the sign that the truncating % of the
+//    full power would give: negative when the base is negative and
+//    the exponent odd.  The sign of the modulus does not matter.
+//    Throws domain_error for a zero modulus or a negative exponent.
+//
+
+bigint powmod (const bigint& base, const bigint& exponent,
+               const bigint& modulus) {
+   DEBUGF ('^', "base = " << base << ", exponent = " << exponent
+           << ", modulus = " << modulus);
+   if (exponent.is_negative) {
+      throw domain_error ("powmod: negative exponent");
    }
+   bigint result (upowmod (base.uvalue, exponent.uvalue,
+                           modulus.uvalue),
+                  base.is_negative and exponent.is_odd());
    DEBUGF ('^', "result = " << result);
    return result;
 }
 
+//
+// isqrt -
+//    Floor of the square root, dc's v at scale 0.  Throws
+//    domain_error for a negative number.
+//
+
+bigint isqrt (const bigint& number) {
+   if (number.is_negative) throw domain_error ("isqrt: negative");
+   return usqrt (number.uvalue);
+}
+
+//
+// gcd -
+//    Greatest common divisor of the magnitudes, never negative, and
+//    zero only when both numbers are.
+//
+
+bigint gcd (const bigint& left, const bigint& right) {
+   return ugcd (left.uvalue, right.uvalue);
+}
@@ -1,6 +1,45 @@
 // Library functions not members of any class.
 
+#ifndef __LIBFNS_H__
+#define __LIBFNS_H__
+
+#include <cstddef>
+#include <iostream>
+using namespace std;
+
 #include "bigint.h"
 
-bigint pow (const bigint& base, const bigint& exponent);
+bigint pow (bigint base, bigint exponent);
+bigint powmod (const bigint& base, const bigint& exponent,
+               const bigint& modulus);
+bigint isqrt (const bigint&);
+bigint gcd (const bigint&, const bigint&);
+
+//
+// pow_cache -
+//    The powers that pow has computed most recently, kept so that a
+//    script which raises the same base to the same exponent again
+//    gets a copy instead.  Only powers large enough to be worth the
+//    lookup are kept, and the least recently used are dropped once
+//    the total passes the capacity in bytes; a capacity of zero
+//    turns the cache off.
+// statistics -
+//    Lookups that found the power and that did not, and the entries
+//    and bytes held now.
+//
+
+class pow_cache {
+   public:
+      struct counters {
+         size_t hits;
+         size_t misses;
+         size_t entries;
+         size_t bytes;
+      };
+      static void set_capacity (size_t bytes);
+      static counters statistics();
+};
+
+ostream& operator<< (ostream&, const pow_cache::counters&);
 
+#endif
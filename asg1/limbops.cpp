@@ -0,0 +1,1007 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+#if defined (__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "limbops.h"
+#include "limbpool.h"
+#include "smallvec.h"
+#include "workpool.h"
+
+size_t limb_thresholds::mul_karatsuba = 32;
+size_t limb_thresholds::mul_toom3 = 160;
+size_t limb_thresholds::mul_ntt = 2500;
+size_t limb_thresholds::div_burnikel = 80;
+size_t limb_thresholds::radix_dc = 30;
+size_t limb_thresholds::mul_parallel = 1500;
+
+bool limb_thresholds::set (const string& spec) {
+   static const unordered_map<string,size_t*> names {
+      {"karatsuba", &mul_karatsuba},
+      {"toom3"    , &mul_toom3    },
+      {"ntt"      , &mul_ntt      },
+      {"burnikel" , &div_burnikel },
+      {"radix"    , &radix_dc     },
+      {"parallel" , &mul_parallel },
+   };
+   size_t equals = spec.find ('=');
+   if (equals == string::npos) return false;
+   auto name = names.find (spec.substr (0, equals));
+   if (name == names.end()) return false;
+   string value = spec.substr (equals + 1);
+   if (value.empty() or value.find_first_not_of ("0123456789")
+                        != string::npos) return false;
+   *name->second = stoul (value);
+   return true;
+}
+
+// Scratch arrays come from limbpool, so the many temporaries of the
+// recursive algorithms are recycled rather than reallocated, and
+// the smallest of them need no allocation at all.
+using limbvec = smallvec<limb_t,4,pool_allocator<limb_t>>;
+
+size_t limbs_normalize (const limb_t* ap, size_t an) {
+   while (an > 0 and ap[an - 1] == 0) --an;
+   return an;
+}
+
+int limbs_cmp (const limb_t* ap, const limb_t* bp, size_t n) {
+   while (n-- > 0) {
+      if (ap[n] != bp[n]) return ap[n] < bp[n] ? -1 : 1;
+   }
+   return 0;
+}
+
+//
+// Addition and subtraction kernels.
+//    The scalar loops carry through a 64-bit accumulator.  The AVX2
+//    loops do eight limbs at a time: the lane sums are formed in
+//    parallel, each lane is classified as generating a carry (it
+//    wrapped) or propagating one (it is all ones), and the carries
+//    into all eight lanes are resolved at once with the
+//    carry-lookahead identity
+//       incoming = (((generate << 1) | carry_in) + propagate)
+//                  ^ propagate
+//    on the two 8-bit lane masks.  Subtraction is the same with
+//    borrows, where a zero lane propagates.  The kernel is picked
+//    once, at first use, from the CPU's feature flags.
+//
+
+static limb_t add_n_scalar (limb_t* rp, const limb_t* ap,
+                            const limb_t* bp, size_t n, limb_t carry) {
+   dlimb_t acc = carry;
+   for (size_t index = 0; index < n; ++index) {
+      acc += dlimb_t (ap[index]) + bp[index];
+      rp[index] = static_cast<limb_t> (acc);
+      acc >>= LIMB_BITS;
+   }
+   return static_cast<limb_t> (acc);
+}
+
+static limb_t sub_n_scalar (limb_t* rp, const limb_t* ap,
+                            const limb_t* bp, size_t n, limb_t borrow) {
+   for (size_t index = 0; index < n; ++index) {
+      dlimb_t diff = dlimb_t (ap[index]) - bp[index] - borrow;
+      rp[index] = static_cast<limb_t> (diff);
+      borrow = (diff >> LIMB_BITS) & 1;
+   }
+   return borrow;
+}
+
+using add_n_fn = limb_t (*) (limb_t*, const limb_t*, const limb_t*,
+                             size_t, limb_t);
+
+#if defined (__x86_64__)
+
+// Lanes whose bit is set in mask become all ones, the rest zero.
+__attribute__ ((target ("avx2")))
+static inline __m256i lanes_from_mask (unsigned mask) {
+   const __m256i lane_bits = _mm256_setr_epi32 (1, 2, 4, 8,
+                                                16, 32, 64, 128);
+   __m256i selected = _mm256_and_si256 (_mm256_set1_epi32 (mask),
+                                        lane_bits);
+   return _mm256_cmpeq_epi32 (selected, lane_bits);
+}
+
+__attribute__ ((target ("avx2")))
+static inline unsigned mask_from_lanes (__m256i lanes) {
+   return _mm256_movemask_ps (_mm256_castsi256_ps (lanes));
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i load_lanes (const limb_t* ap) {
+   return _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (ap));
+}
+
+__attribute__ ((target ("avx2")))
+static inline void store_lanes (limb_t* rp, __m256i lanes) {
+   _mm256_storeu_si256 (reinterpret_cast<__m256i*> (rp), lanes);
+}
+
+__attribute__ ((target ("avx2")))
+static limb_t add_n_avx2 (limb_t* rp, const limb_t* ap,
+                          const limb_t* bp, size_t n, limb_t carry) {
+   const __m256i ones = _mm256_set1_epi32 (-1);
+   size_t index = 0;
+   for (; index + 8 <= n; index += 8) {
+      __m256i left = load_lanes (ap + index);
+      __m256i sum = _mm256_add_epi32 (left, load_lanes (bp + index));
+      // A lane wrapped exactly when its sum is below an operand.
+      __m256i kept = _mm256_cmpeq_epi32 (_mm256_max_epu32 (sum, left),
+                                         sum);
+      unsigned generate = ~mask_from_lanes (kept) & 0xFF;
+      unsigned propagate = mask_from_lanes (
+            _mm256_cmpeq_epi32 (sum, ones));
+      unsigned chain = ((generate << 1) | carry) + propagate;
+      carry = ((chain >> 8) | (generate >> 7)) & 1;
+      // Subtracting an all ones lane adds its incoming carry.
+      store_lanes (rp + index, _mm256_sub_epi32 (sum,
+                   lanes_from_mask (chain ^ propagate)));
+   }
+   return add_n_scalar (rp + index, ap + index, bp + index, n - index,
+                        carry);
+}
+
+__attribute__ ((target ("avx2")))
+static limb_t sub_n_avx2 (limb_t* rp, const limb_t* ap,
+                          const limb_t* bp, size_t n, limb_t borrow) {
+   const __m256i zero = _mm256_setzero_si256();
+   size_t index = 0;
+   for (; index + 8 <= n; index += 8) {
+      __m256i left = load_lanes (ap + index);
+      __m256i right = load_lanes (bp + index);
+      __m256i diff = _mm256_sub_epi32 (left, right);
+      // A lane borrows exactly when its subtrahend is larger.
+      __m256i kept = _mm256_cmpeq_epi32 (_mm256_max_epu32 (left, right),
+                                         left);
+      unsigned generate = ~mask_from_lanes (kept) & 0xFF;
+      unsigned propagate = mask_from_lanes (
+            _mm256_cmpeq_epi32 (diff, zero));
+      unsigned chain = ((generate << 1) | borrow) + propagate;
+      borrow = ((chain >> 8) | (generate >> 7)) & 1;
+      // Adding an all ones lane subtracts its incoming borrow.
+      store_lanes (rp + index, _mm256_add_epi32 (diff,
+                   lanes_from_mask (chain ^ propagate)));
+   }
+   return sub_n_scalar (rp + index, ap + index, bp + index, n - index,
+                        borrow);
+}
+
+#endif
+
+limb_t limbs_add_n (limb_t* rp, const limb_t* ap, const limb_t* bp,
+                    size_t n) {
+#if defined (__x86_64__)
+   static const add_n_fn kernel = __builtin_cpu_supports ("avx2")
+                                ? add_n_avx2 : add_n_scalar;
+#else
+   static const add_n_fn kernel = add_n_scalar;
+#endif
+   return kernel (rp, ap, bp, n, 0);
+}
+
+limb_t limbs_sub_n (limb_t* rp, const limb_t* ap, const limb_t* bp,
+                    size_t n) {
+#if defined (__x86_64__)
+   static const add_n_fn kernel = __builtin_cpu_supports ("avx2")
+                                ? sub_n_avx2 : sub_n_scalar;
+#else
+   static const add_n_fn kernel = sub_n_scalar;
+#endif
+   return kernel (rp, ap, bp, n, 0);
+}
+
+limb_t limbs_add_1 (limb_t* rp, const limb_t* ap, size_t an, limb_t b) {
+   size_t index = 0;
+   for (; index < an and b != 0; ++index) {
+      limb_t sum = ap[index] + b;
+      b = sum < b;
+      rp[index] = sum;
+   }
+   if (rp != ap) copy (ap + index, ap + an, rp + index);
+   return b;
+}
+
+limb_t limbs_sub_1 (limb_t* rp, const limb_t* ap, size_t an, limb_t b) {
+   size_t index = 0;
+   for (; index < an and b != 0; ++index) {
+      limb_t diff = ap[index] - b;
+      b = diff > ap[index];
+      rp[index] = diff;
+   }
+   if (rp != ap) copy (ap + index, ap + an, rp + index);
+   return b;
+}
+
+limb_t limbs_add (limb_t* rp, const limb_t* ap, size_t an,
+                  const limb_t* bp, size_t bn) {
+   limb_t carry = limbs_add_n (rp, ap, bp, bn);
+   return limbs_add_1 (rp + bn, ap + bn, an - bn, carry);
+}
+
+limb_t limbs_sub (limb_t* rp, const limb_t* ap, size_t an,
+                  const limb_t* bp, size_t bn) {
+   limb_t borrow = limbs_sub_n (rp, ap, bp, bn);
+   return limbs_sub_1 (rp + bn, ap + bn, an - bn, borrow);
+}
+
+limb_t limbs_mul_1 (limb_t* rp, const limb_t* ap, size_t an, limb_t b) {
+   dlimb_t carry = 0;
+   for (size_t index = 0; index < an; ++index) {
+      carry += dlimb_t (ap[index]) * b;
+      rp[index] = static_cast<limb_t> (carry);
+      carry >>= LIMB_BITS;
+   }
+   return static_cast<limb_t> (carry);
+}
+
+limb_t limbs_addmul_1 (limb_t* rp, const limb_t* ap, size_t an,
+                       limb_t b) {
+   dlimb_t carry = 0;
+   for (size_t index = 0; index < an; ++index) {
+      carry += dlimb_t (ap[index]) * b + rp[index];
+      rp[index] = static_cast<limb_t> (carry);
+      carry >>= LIMB_BITS;
+   }
+   return static_cast<limb_t> (carry);
+}
+
+limb_t limbs_submul_1 (limb_t* rp, const limb_t* ap, size_t an,
+                       limb_t b) {
+   dlimb_t carry = 0;
+   for (size_t index = 0; index < an; ++index) {
+      carry += dlimb_t (ap[index]) * b;
+      limb_t low = static_cast<limb_t> (carry);
+      carry >>= LIMB_BITS;
+      limb_t diff = rp[index] - low;
+      carry += diff > rp[index];
+      rp[index] = diff;
+   }
+   return static_cast<limb_t> (carry);
+}
+
+limb_t limbs_lshift (limb_t* rp, const limb_t* ap, size_t an,
+                     unsigned count) {
+   limb_t out = 0;
+   for (size_t index = 0; index < an; ++index) {
+      limb_t limb = ap[index];
+      rp[index] = (limb << count) | out;
+      out = limb >> (LIMB_BITS - count);
+   }
+   return out;
+}
+
+limb_t limbs_rshift (limb_t* rp, const limb_t* ap, size_t an,
+                     unsigned count) {
+   limb_t out = 0;
+   for (size_t index = an; index-- > 0; ) {
+      limb_t limb = ap[index];
+      rp[index] = (limb >> count) | out;
+      out = limb << (LIMB_BITS - count);
+   }
+   return out;
+}
+
+//
+// mul_basecase -
+//    Schoolbook multiplication, one addmul_1 pass per limb of b.
+//
+
+static void mul_basecase (limb_t* rp, const limb_t* ap, size_t an,
+                          const limb_t* bp, size_t bn) {
+   rp[an] = limbs_mul_1 (rp, ap, an, bp[0]);
+   for (size_t index = 1; index < bn; ++index) {
+      rp[an + index] = limbs_addmul_1 (rp + index, ap, an, bp[index]);
+   }
+}
+
+//
+// sqr_basecase -
+//    Schoolbook squaring.  Each cross product a[i]*a[j], i < j,
+//    occurs twice in the square, so it is formed once, the sum of
+//    them is doubled with a shift, and the diagonal squares a[i]^2
+//    are added in, for about half the work of mul_basecase.
+//
+
+static void sqr_basecase (limb_t* rp, const limb_t* ap, size_t an) {
+   rp[0] = 0;
+   rp[2 * an - 1] = 0;
+   if (an > 1) {
+      rp[an] = limbs_mul_1 (rp + 1, ap + 1, an - 1, ap[0]);
+      for (size_t index = 1; index < an - 1; ++index) {
+         rp[an + index] = limbs_addmul_1 (rp + 2 * index + 1,
+                                          ap + index + 1,
+                                          an - index - 1, ap[index]);
+      }
+      limbs_lshift (rp, rp, 2 * an, 1);
+   }
+   dlimb_t carry = 0;
+   for (size_t index = 0; index < an; ++index) {
+      dlimb_t square = dlimb_t (ap[index]) * ap[index];
+      dlimb_t low = carry + rp[2 * index] + limb_t (square);
+      rp[2 * index] = limb_t (low);
+      dlimb_t high = (low >> LIMB_BITS) + rp[2 * index + 1]
+                   + (square >> LIMB_BITS);
+      rp[2 * index + 1] = limb_t (high);
+      carry = high >> LIMB_BITS;
+   }
+   assert (carry == 0);
+}
+
+//
+// add_into -
+//    Add {bp,bn} into rp starting at limb offset, where rp holds rn
+//    limbs.  Used when assembling the pieces of a split product;
+//    the true sum always fits, so any carry out is a logic error.
+//
+
+static void add_into (limb_t* rp, size_t rn, size_t offset,
+                      const limb_t* bp, size_t bn) {
+   bn = limbs_normalize (bp, bn);
+   if (bn == 0) return;
+   assert (offset + bn <= rn);
+   limb_t carry = limbs_add (rp + offset, rp + offset, rn - offset,
+                             bp, bn);
+   assert (carry == 0);
+   (void) carry;
+}
+
+//
+// fork_products -
+//    Run the independent subproducts of a split multiplication on
+//    the workpool once the operands are large enough to repay the
+//    hand-off, otherwise one after another on this thread.  The
+//    threshold is checked first, and the products are passed by
+//    reference, so the common small case costs no more than the
+//    calls themselves.
+//
+
+template <typename... products_t>
+static void fork_products (size_t limbs, products_t&&... products) {
+   if (limbs < limb_thresholds::mul_parallel
+       or workpool::threads() < 2) {
+      (products(), ...);
+      return;
+   }
+   const workpool::task_ref tasks[] {products...};
+   workpool::fork_join (tasks, sizeof... (products));
+}
+
+//
+// mul_karatsuba -
+//    Requires an >= bn > an/2.  Splitting at m = an/2,
+//       a*b = z2*B^2m + (sa*sb - z2 - z0)*B^m + z0
+//    where z0 = a0*b0, z2 = a1*b1, sa = a0+a1, and sb = b0+b1,
+//    so three half size products replace four.
+//
+
+static void mul_karatsuba (limb_t* rp, const limb_t* ap, size_t an,
+                           const limb_t* bp, size_t bn) {
+   size_t m = an / 2;
+   const limb_t* a1 = ap + m;
+   const limb_t* b1 = bp + m;
+   size_t a1n = an - m;
+   size_t b1n = bn - m;
+
+   limbvec sa (a1n + 1);
+   sa[a1n] = limbs_add (sa.data(), a1, a1n, ap, m);
+   size_t sbn = max (m, b1n);
+   limbvec sb (sbn + 1);
+   sb[sbn] = m >= b1n ? limbs_add (sb.data(), bp, m, b1, b1n)
+                      : limbs_add (sb.data(), b1, b1n, bp, m);
+
+   limbvec z1 (sa.size() + sb.size());
+   fork_products (bn,
+      [&] { limbs_mul (rp, ap, m, bp, m); },
+      [&] { limbs_mul (rp + 2 * m, a1, a1n, b1, b1n); },
+      [&] { limbs_mul (z1.data(), sa.data(), sa.size(),
+                       sb.data(), sb.size()); });
+   limb_t borrow = limbs_sub (z1.data(), z1.data(), z1.size(),
+                              rp, 2 * m);
+   borrow |= limbs_sub (z1.data(), z1.data(), z1.size(),
+                        rp + 2 * m, a1n + b1n);
+   assert (borrow == 0);
+   (void) borrow;
+   add_into (rp, an + bn, m, z1.data(), z1.size());
+}
+
+//
+// sqr_karatsuba -
+//    Karatsuba for a*a, with the same split as mul_karatsuba.  All
+//    three subproducts are squares, and sa is formed only once.
+//
+
+static void sqr_karatsuba (limb_t* rp, const limb_t* ap, size_t an) {
+   size_t m = an / 2;
+   const limb_t* a1 = ap + m;
+   size_t a1n = an - m;
+
+   limbvec sa (a1n + 1);
+   sa[a1n] = limbs_add (sa.data(), a1, a1n, ap, m);
+
+   limbvec z1 (2 * sa.size());
+   fork_products (an,
+      [&] { limbs_sqr (rp, ap, m); },
+      [&] { limbs_sqr (rp + 2 * m, a1, a1n); },
+      [&] { limbs_sqr (z1.data(), sa.data(), sa.size()); });
+   limb_t borrow = limbs_sub (z1.data(), z1.data(), z1.size(),
+                              rp, 2 * m);
+   borrow |= limbs_sub (z1.data(), z1.data(), z1.size(),
+                        rp + 2 * m, 2 * a1n);
+   assert (borrow == 0);
+   (void) borrow;
+   add_into (rp, 2 * an, m, z1.data(), z1.size());
+}
+
+//
+// Signed intermediates for Toom-3, whose evaluation at -1 and -2
+// can go negative.  Magnitudes are kept normalized.
+//
+
+struct slimbs {
+   limbvec mag;
+   bool neg {false};
+};
+
+static slimbs s_make (const limb_t* ap, size_t an) {
+   an = limbs_normalize (ap, an);
+   return {limbvec (ap, ap + an), false};
+}
+
+static void s_trim (slimbs& x) {
+   x.mag.resize (limbs_normalize (x.mag.data(), x.mag.size()));
+   if (x.mag.empty()) x.neg = false;
+}
+
+static slimbs s_add (const slimbs& x, const slimbs& y, bool negate_y) {
+   bool yneg = y.neg != negate_y;
+   const limbvec& big = x.mag.size() >= y.mag.size() ? x.mag : y.mag;
+   const limbvec& small = &big == &x.mag ? y.mag : x.mag;
+   slimbs result;
+   if (x.neg == yneg) {
+      result.mag.resize (big.size() + 1);
+      result.mag[big.size()] = limbs_add (result.mag.data(),
+            big.data(), big.size(), small.data(), small.size());
+      result.neg = x.neg;
+   }else {
+      bool x_bigger = x.mag.size() != y.mag.size()
+            ? x.mag.size() > y.mag.size()
+            : limbs_cmp (x.mag.data(), y.mag.data(), x.mag.size()) >= 0;
+      const limbvec& minuend = x_bigger ? x.mag : y.mag;
+      const limbvec& subtrahend = x_bigger ? y.mag : x.mag;
+      result.mag.resize (minuend.size());
+      limbs_sub (result.mag.data(), minuend.data(), minuend.size(),
+                 subtrahend.data(), subtrahend.size());
+      result.neg = x_bigger ? x.neg : yneg;
+   }
+   s_trim (result);
+   return result;
+}
+
+// Multiplying a value by itself squares it.
+static slimbs s_mul (const slimbs& x, const slimbs& y) {
+   slimbs result;
+   if (x.mag.empty() or y.mag.empty()) return result;
+   result.mag.resize (x.mag.size() + y.mag.size());
+   if (&x == &y) {
+      limbs_sqr (result.mag.data(), x.mag.data(), x.mag.size());
+   }else {
+      limbs_mul (result.mag.data(), x.mag.data(), x.mag.size(),
+                 y.mag.data(), y.mag.size());
+   }
+   result.neg = x.neg != y.neg;
+   s_trim (result);
+   return result;
+}
+
+static void s_shl1 (slimbs& x) {
+   x.mag.push_back (0);
+   limbs_add_n (x.mag.data(), x.mag.data(), x.mag.data(), x.mag.size());
+   s_trim (x);
+}
+
+// Exact division by a small constant; the interpolation guarantees
+// that the remainder is zero.
+static void s_divexact (slimbs& x, limb_t divisor) {
+   dlimb_t rem = 0;
+   for (size_t index = x.mag.size(); index-- > 0; ) {
+      dlimb_t acc = (rem << LIMB_BITS) | x.mag[index];
+      x.mag[index] = static_cast<limb_t> (acc / divisor);
+      rem = acc % divisor;
+   }
+   assert (rem == 0);
+   s_trim (x);
+}
+
+//
+// mul_toom3 -
+//    Requires bn > 2k where k = ceil(an/3).  Splits each operand
+//    into three k-limb pieces, evaluates at 0, 1, -1, -2, and
+//    infinity, multiplies the five point values, and interpolates
+//    with the Bodrato sequence.  A square evaluates its operand
+//    once and squares the point values.
+//
+
+static void mul_toom3 (limb_t* rp, const limb_t* ap, size_t an,
+                       const limb_t* bp, size_t bn) {
+   size_t k = (an + 2) / 3;
+   bool square = ap == bp and an == bn;
+   slimbs a0 = s_make (ap, k);
+   slimbs a1 = s_make (ap + k, k);
+   slimbs a2 = s_make (ap + 2 * k, an - 2 * k);
+   slimbs b0, b1, b2;
+   if (not square) {
+      b0 = s_make (bp, k);
+      b1 = s_make (bp + k, k);
+      b2 = s_make (bp + 2 * k, bn - 2 * k);
+   }
+
+   auto evaluate = [] (const slimbs& m0, const slimbs& m1,
+                       const slimbs& m2, slimbs* points) {
+      slimbs p0 = s_add (m0, m2, false);
+      points[0] = s_add (p0, m1, false);         // p(1)
+      points[1] = s_add (p0, m1, true);          // p(-1)
+      points[2] = s_add (points[1], m2, false);
+      s_shl1 (points[2]);
+      points[2] = s_add (points[2], m0, true);   // p(-2)
+   };
+   slimbs pa[3], pb[3];
+   evaluate (a0, a1, a2, pa);
+   if (not square) evaluate (b0, b1, b2, pb);
+   const slimbs& f0 = square ? a0 : b0;
+   const slimbs& f2 = square ? a2 : b2;
+   const slimbs* fp = square ? pa : pb;
+
+   slimbs r0, r1, rm1, rm2, r4;
+   fork_products (bn,
+      [&] { r0 = s_mul (a0, f0); },
+      [&] { r1 = s_mul (pa[0], fp[0]); },
+      [&] { rm1 = s_mul (pa[1], fp[1]); },
+      [&] { rm2 = s_mul (pa[2], fp[2]); },
+      [&] { r4 = s_mul (a2, f2); });
+
+   slimbs r3 = s_add (rm2, r1, true);
+   s_divexact (r3, 3);
+   r1 = s_add (r1, rm1, true);
+   s_divexact (r1, 2);
+   slimbs r2 = s_add (rm1, r0, true);
+   r3 = s_add (r2, r3, true);
+   s_divexact (r3, 2);
+   slimbs twice_r4 = r4;
+   s_shl1 (twice_r4);
+   r3 = s_add (r3, twice_r4, false);
+   r2 = s_add (s_add (r2, r1, false), r4, true);
+   r1 = s_add (r1, r3, true);
+
+   size_t rn = an + bn;
+   fill (rp, rp + rn, 0);
+   const slimbs* coeffs[] = {&r0, &r1, &r2, &r3, &r4};
+   for (size_t index = 0; index < 5; ++index) {
+      assert (not coeffs[index]->neg);
+      add_into (rp, rn, index * k, coeffs[index]->mag.data(),
+                coeffs[index]->mag.size());
+   }
+}
+
+//
+// mul_unbalanced -
+//    When a is at least twice as long as b, cut a into bn-limb
+//    slices and accumulate the balanced slice products.
+//
+
+static void mul_unbalanced (limb_t* rp, const limb_t* ap, size_t an,
+                            const limb_t* bp, size_t bn) {
+   fill (rp, rp + an + bn, 0);
+   limbvec slice (2 * bn);
+   for (size_t pos = 0; pos < an; pos += bn) {
+      size_t len = min (bn, an - pos);
+      limbs_mul (slice.data(), ap + pos, len, bp, bn);
+      add_into (rp, an + bn, pos, slice.data(), len + bn);
+   }
+}
+
+//
+// Number theoretic transform multiplication.
+//    The limbs are convolved modulo three primes of the form
+//    c*2^k+1, each with 3 as a primitive root, and the exact
+//    coefficients are put back together by the Chinese remainder
+//    theorem (Garner's method).  A coefficient is a sum of at most
+//    min(an,bn) two-limb products, under 2^22 * 2^64 while the
+//    transform is no longer than 2^23, the most the first prime
+//    allows, and that is less than the product of the three primes.
+//
+
+static const limb_t NTT_PRIMES[] {998244353, 167772161, 469762049};
+static const limb_t NTT_ROOT = 3;
+static const size_t NTT_MAX_LENGTH = size_t (1) << 23;
+
+static limb_t mod_pow (limb_t base, limb_t exponent, limb_t modulus) {
+   dlimb_t result = 1;
+   for (dlimb_t square = base; exponent != 0; exponent >>= 1) {
+      if (exponent & 1) result = result * square % modulus;
+      square = square * square % modulus;
+   }
+   return static_cast<limb_t> (result);
+}
+
+//
+// ntt_transform -
+//    In place iterative radix-2 transform of a power of two length
+//    array, or its inverse, scaled by 1/n.  The primes are below
+//    2^30, so sums of two residues do not overflow a limb.
+//
+
+static void ntt_transform (limbvec& data, limb_t modulus,
+                           bool inverse) {
+   size_t n = data.size();
+   for (size_t index = 1, mirror = 0; index < n; ++index) {
+      size_t bit = n >> 1;
+      for (; mirror & bit; bit >>= 1) mirror ^= bit;
+      mirror ^= bit;
+      if (index < mirror) swap (data[index], data[mirror]);
+   }
+   limbvec twiddles;
+   for (size_t len = 2; len <= n; len <<= 1) {
+      size_t half = len / 2;
+      limb_t step = mod_pow (NTT_ROOT, (modulus - 1) / len, modulus);
+      if (inverse) step = mod_pow (step, modulus - 2, modulus);
+      twiddles.resize (half);
+      twiddles[0] = 1;
+      for (size_t k = 1; k < half; ++k) {
+         twiddles[k] = dlimb_t (twiddles[k - 1]) * step % modulus;
+      }
+      for (size_t start = 0; start < n; start += len) {
+         limb_t* lo = data.data() + start;
+         limb_t* hi = lo + half;
+         for (size_t k = 0; k < half; ++k) {
+            limb_t u = lo[k];
+            limb_t v = dlimb_t (hi[k]) * twiddles[k] % modulus;
+            lo[k] = u + v >= modulus ? u + v - modulus : u + v;
+            hi[k] = u >= v ? u - v : u + modulus - v;
+         }
+      }
+   }
+   if (inverse) {
+      dlimb_t scale = mod_pow (n % modulus, modulus - 2, modulus);
+      for (limb_t& item: data) item = item * scale % modulus;
+   }
+}
+
+//
+// ntt_convolve -
+//    Cyclic convolution of a and b modulo one prime, length
+//    coefficients long.  A square transforms its operand once.
+//
+
+static void ntt_convolve (limbvec& result, const limb_t* ap, size_t an,
+                          const limb_t* bp, size_t bn, size_t length,
+                          limb_t modulus) {
+   auto load = [&] (limbvec& data, const limb_t* xp, size_t xn) {
+      data.assign (length, 0);
+      for (size_t index = 0; index < xn; ++index) {
+         data[index] = xp[index] % modulus;
+      }
+      ntt_transform (data, modulus, false);
+   };
+   load (result, ap, an);
+   if (ap == bp and an == bn) {
+      for (limb_t& item: result) item = dlimb_t (item) * item % modulus;
+   }else {
+      limbvec other;
+      load (other, bp, bn);
+      for (size_t index = 0; index < length; ++index) {
+         result[index] = dlimb_t (result[index]) * other[index]
+                       % modulus;
+      }
+   }
+   ntt_transform (result, modulus, true);
+}
+
+//
+// mul_ntt -
+//    Requires an + bn <= NTT_MAX_LENGTH.  The three convolutions are
+//    independent and go to the workpool like any other subproducts.
+//
+
+static void mul_ntt (limb_t* rp, const limb_t* ap, size_t an,
+                     const limb_t* bp, size_t bn) {
+   size_t length = 1;
+   while (length < an + bn - 1) length <<= 1;
+   limbvec residues[3];
+   fork_products (bn,
+      [&] { ntt_convolve (residues[0], ap, an, bp, bn, length,
+                          NTT_PRIMES[0]); },
+      [&] { ntt_convolve (residues[1], ap, an, bp, bn, length,
+                          NTT_PRIMES[1]); },
+      [&] { ntt_convolve (residues[2], ap, an, bp, bn, length,
+                          NTT_PRIMES[2]); });
+
+   const dlimb_t m1 = NTT_PRIMES[0];
+   const dlimb_t m2 = NTT_PRIMES[1];
+   const dlimb_t m3 = NTT_PRIMES[2];
+   static const dlimb_t m1_inv_m2 = mod_pow (m1 % m2, m2 - 2, m2);
+   static const dlimb_t m1_inv_m3 = mod_pow (m1 % m3, m3 - 2, m3);
+   static const dlimb_t m2_inv_m3 = mod_pow (m2 % m3, m3 - 2, m3);
+   unsigned __int128 carry = 0;
+   for (size_t index = 0; index < an + bn; ++index) {
+      if (index < an + bn - 1) {
+         dlimb_t v1 = residues[0][index];
+         dlimb_t v2 = (residues[1][index] + m2 - v1 % m2)
+                    * m1_inv_m2 % m2;
+         dlimb_t v3 = (residues[2][index] + m3 - v1 % m3)
+                    * m1_inv_m3 % m3;
+         v3 = (v3 + m3 - v2 % m3) * m2_inv_m3 % m3;
+         unsigned __int128 high = v3;
+         carry += v1 + m1 * (v2 + m2 * high);
+      }
+      rp[index] = static_cast<limb_t> (carry);
+      carry >>= LIMB_BITS;
+   }
+   assert (carry == 0);
+}
+
+//
+// Below this size the split algorithms' pieces are no smaller than
+// their inputs, so recursion would not terminate.  Tuned thresholds
+// are clamped to it.
+//
+
+static const size_t MIN_SPLIT_LIMBS = 8;
+
+void limbs_mul (limb_t* rp, const limb_t* ap, size_t an,
+                const limb_t* bp, size_t bn) {
+   if (ap == bp and an == bn) {
+      limbs_sqr (rp, ap, an);
+      return;
+   }
+   if (an < bn) {
+      swap (ap, bp);
+      swap (an, bn);
+   }
+   if (bn == 0) {
+      fill (rp, rp + an, 0);
+   }else if (bn < max (limb_thresholds::mul_karatsuba,
+                       MIN_SPLIT_LIMBS)) {
+      mul_basecase (rp, ap, an, bp, bn);
+   }else if (bn >= limb_thresholds::mul_ntt
+             and an + bn <= NTT_MAX_LENGTH) {
+      mul_ntt (rp, ap, an, bp, bn);
+   }else if (an >= 2 * bn) {
+      mul_unbalanced (rp, ap, an, bp, bn);
+   }else if (bn >= limb_thresholds::mul_toom3
+             and bn > 2 * ((an + 2) / 3)) {
+      mul_toom3 (rp, ap, an, bp, bn);
+   }else {
+      mul_karatsuba (rp, ap, an, bp, bn);
+   }
+}
+
+void limbs_sqr (limb_t* rp, const limb_t* ap, size_t an) {
+   if (an == 0) {
+      return;
+   }else if (an < max (limb_thresholds::mul_karatsuba,
+                       MIN_SPLIT_LIMBS)) {
+      sqr_basecase (rp, ap, an);
+   }else if (an >= limb_thresholds::mul_ntt
+             and 2 * an <= NTT_MAX_LENGTH) {
+      mul_ntt (rp, ap, an, ap, an);
+   }else if (an >= limb_thresholds::mul_toom3) {
+      mul_toom3 (rp, ap, an, ap, an);
+   }else {
+      sqr_karatsuba (rp, ap, an);
+   }
+}
+
+//
+// Each pass clears one low limb of t by adding a multiple of m.
+// The n limbs left above are less than 2m, so at most one
+// subtraction brings them into range.
+//
+
+void limbs_redc (limb_t* rp, limb_t* tp, const limb_t* mp, size_t n,
+                 limb_t minv) {
+   limb_t high = 0;
+   for (size_t index = 0; index < n; ++index) {
+      limb_t carry = limbs_addmul_1 (tp + index, mp, n,
+                                     tp[index] * minv);
+      high += limbs_add_1 (tp + index + n, tp + index + n, n - index,
+                           carry);
+   }
+   if (high != 0 or limbs_cmp (tp + n, mp, n) >= 0) {
+      limbs_sub_n (rp, tp + n, mp, n);
+   }else {
+      copy (tp + n, tp + 2 * n, rp);
+   }
+}
+
+limb_t limbs_divrem_1 (limb_t* qp, const limb_t* ap, size_t an,
+                       limb_t d) {
+   dlimb_t rem = 0;
+   for (size_t index = an; index-- > 0; ) {
+      dlimb_t acc = (rem << LIMB_BITS) | ap[index];
+      qp[index] = static_cast<limb_t> (acc / d);
+      rem = acc % d;
+   }
+   return static_cast<limb_t> (rem);
+}
+
+//
+// divrem_knuth -
+//    Schoolbook long division, Algorithm D, for dn >= 2.
+//
+
+static void divrem_knuth (limb_t* qp, limb_t* rp,
+                          const limb_t* ap, size_t an,
+                          const limb_t* dp, size_t dn) {
+   // D1: normalize so the divisor's top bit is set, which keeps
+   // each trial quotient within two of the true digit.
+   unsigned shift = __builtin_clz (dp[dn - 1]);
+   limbvec vn (dp, dp + dn);
+   limbvec un (an + 1);
+   if (shift > 0) {
+      limbs_lshift (vn.data(), dp, dn, shift);
+      un[an] = limbs_lshift (un.data(), ap, an, shift);
+   }else {
+      copy (ap, ap + an, un.begin());
+   }
+   const dlimb_t base = dlimb_t (1) << LIMB_BITS;
+   const limb_t vtop = vn[dn - 1];
+   const limb_t vnext = vn[dn - 2];
+
+   for (size_t j = an - dn + 1; j-- > 0; ) {
+      // D3: estimate the quotient digit from the top two limbs and
+      // refine it with the third.
+      dlimb_t num = (dlimb_t (un[j + dn]) << LIMB_BITS)
+                  | un[j + dn - 1];
+      dlimb_t qhat = num / vtop;
+      dlimb_t rhat = num % vtop;
+      while (qhat >= base
+             or qhat * vnext > ((rhat << LIMB_BITS) | un[j + dn - 2])) {
+         --qhat;
+         rhat += vtop;
+         if (rhat >= base) break;
+      }
+      // D4: multiply and subtract; D6: add back if it went negative.
+      limb_t qdigit = static_cast<limb_t> (qhat);
+      limb_t borrow = limbs_submul_1 (un.data() + j, vn.data(), dn,
+                                      qdigit);
+      bool negative = un[j + dn] < borrow;
+      un[j + dn] -= borrow;
+      if (negative) {
+         --qdigit;
+         un[j + dn] += limbs_add_n (un.data() + j, un.data() + j,
+                                    vn.data(), dn);
+      }
+      qp[j] = qdigit;
+   }
+   // D8: unnormalize the remainder.
+   if (shift > 0) limbs_rshift (rp, un.data(), dn, shift);
+             else copy (un.begin(), un.begin() + dn, rp);
+}
+
+//
+// Burnikel-Ziegler recursive division.  Both routines take a
+// normalized divisor {bp,n}, top bit set, and a dividend below
+// b*B^k, so the quotient fits in k limbs.
+//
+//    div_2n1n divides 2n limbs by n limbs, giving n quotient limbs.
+//    div_3n2n divides n+k limbs by n limbs, giving k <= n quotient
+//       limbs, by dividing the top 2k limbs by the top k limbs of
+//       b and correcting the estimate with one k by n-k product.
+//
+// The only quadratic step is the Algorithm D base case, so the cost
+// is governed by the multiplication algorithm in use.
+//
+
+static void div_2n1n (limb_t* qp, limb_t* rp, const limb_t* ap,
+                      const limb_t* bp, size_t n);
+
+static void div_3n2n (limb_t* qp, limb_t* rp, const limb_t* ap,
+                      const limb_t* bp, size_t n, size_t k) {
+   size_t low = n - k;
+   const limb_t* b1 = bp + low;
+   const limb_t* a12 = ap + low;
+
+   // Estimate from the top halves, one high by at most two.
+   limbvec rhat (n + 1, 0);
+   if (limbs_cmp (ap + n, b1, k) < 0) {
+      div_2n1n (qp, rhat.data() + low, a12, b1, k);
+   }else {
+      fill (qp, qp + k, ~limb_t (0));
+      rhat[n] = limbs_add (rhat.data() + low, a12, k, b1, k);
+   }
+   copy (ap, ap + low, rhat.begin());
+
+   // rhat = (a12 - q*b1)*B^low + a3 - q*b2, wrapped in n+1 limbs.
+   bool negative = false;
+   if (low > 0) {
+      limbvec product (n);
+      limbs_mul (product.data(), qp, k, bp, low);
+      negative = limbs_sub (rhat.data(), rhat.data(), n + 1,
+                            product.data(), n);
+   }
+   while (negative) {
+      limbs_sub_1 (qp, qp, k, 1);
+      negative = not limbs_add (rhat.data(), rhat.data(), n + 1, bp, n);
+   }
+   assert (rhat[n] == 0);
+   copy (rhat.begin(), rhat.begin() + n, rp);
+}
+
+static void div_2n1n (limb_t* qp, limb_t* rp, const limb_t* ap,
+                      const limb_t* bp, size_t n) {
+   if (n < max (limb_thresholds::div_burnikel, MIN_SPLIT_LIMBS)) {
+      limbvec quotient (n + 1);
+      if (n == 1) {
+         rp[0] = limbs_divrem_1 (quotient.data(), ap, 2, bp[0]);
+      }else {
+         divrem_knuth (quotient.data(), rp, ap, 2 * n, bp, n);
+      }
+      assert (quotient[n] == 0);
+      copy (quotient.begin(), quotient.begin() + n, qp);
+      return;
+   }
+   size_t low = n / 2;
+   size_t high = n - low;
+   limbvec partial (n + low);
+   div_3n2n (qp + low, partial.data() + low, ap + low, bp, n, high);
+   copy (ap, ap + low, partial.begin());
+   div_3n2n (qp, rp, partial.data(), bp, n, low);
+}
+
+//
+// divrem_burnikel -
+//    Normalize, then feed the dividend to div_3n2n one block of at
+//    most dn quotient limbs at a time, top block first.
+//
+
+static void divrem_burnikel (limb_t* qp, limb_t* rp,
+                             const limb_t* ap, size_t an,
+                             const limb_t* dp, size_t dn) {
+   unsigned shift = __builtin_clz (dp[dn - 1]);
+   limbvec vn (dp, dp + dn);
+   limbvec un (an + 1);
+   if (shift > 0) {
+      limbs_lshift (vn.data(), dp, dn, shift);
+      un[an] = limbs_lshift (un.data(), ap, an, shift);
+   }else {
+      copy (ap, ap + an, un.begin());
+   }
+   // The top dn limbs of un are below vn, since un[an] is less than
+   // 2^shift and vn's top limb is at least 2^31.
+   size_t pos = an + 1 - dn;
+   limbvec rem (un.begin() + pos, un.end());
+   limbvec block (2 * dn);
+   while (pos > 0) {
+      size_t k = min (dn, pos);
+      pos -= k;
+      copy (un.begin() + pos, un.begin() + pos + k, block.begin());
+      copy (rem.begin(), rem.end(), block.begin() + k);
+      div_3n2n (qp + pos, rem.data(), block.data(), vn.data(), dn, k);
+   }
+   if (shift > 0) limbs_rshift (rp, rem.data(), dn, shift);
+             else copy (rem.begin(), rem.end(), rp);
+}
+
+void limbs_divrem (limb_t* qp, limb_t* rp, const limb_t* ap, size_t an,
+                   const limb_t* dp, size_t dn) {
+   assert (an >= dn and dn > 0 and dp[dn - 1] != 0);
+   size_t threshold = max (limb_thresholds::div_burnikel,
+                           MIN_SPLIT_LIMBS);
+   if (dn == 1) {
+      rp[0] = limbs_divrem_1 (qp, ap, an, dp[0]);
+   }else if (dn < threshold or an - dn < threshold) {
+      divrem_knuth (qp, rp, ap, an, dp, dn);
+   }else {
+      divrem_burnikel (qp, rp, ap, an, dp, dn);
+   }
+}
+
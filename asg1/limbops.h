@@ -0,0 +1,140 @@
+//
+// limbops -
+//    Low level arithmetic on raw arrays of 32-bit limbs, least
+//    significant limb first.  These are the kernels underneath
+//    ubigint and know nothing about signs or allocation policy:
+//    the caller supplies result arrays of the documented length.
+//
+
+#ifndef __LIMBOPS_H__
+#define __LIMBOPS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+using limb_t = uint32_t;
+using dlimb_t = uint64_t;
+const int LIMB_BITS = 32;
+
+//
+// limb_thresholds -
+//    Operand sizes, in limbs, at which the multiplication, division,
+//    and decimal conversion code switch algorithms, and above which
+//    the subproducts of a split multiplication go to the workpool.
+//    Plain statics so that they can be tuned per host without
+//    recompiling.
+// set -
+//    Takes "name=limbs", where name is karatsuba, toom3, ntt,
+//    burnikel, radix, or parallel.  Returns false if the spec is not
+//    understood.
+//
+
+class limb_thresholds {
+   public:
+      static size_t mul_karatsuba;
+      static size_t mul_toom3;
+      static size_t mul_ntt;
+      static size_t div_burnikel;
+      static size_t radix_dc;
+      static size_t mul_parallel;
+      static bool set (const string& spec);
+};
+
+// Length of the array once high order zero limbs are dropped.
+size_t limbs_normalize (const limb_t* ap, size_t an);
+
+// Compare two arrays of equal length: -1, 0, or +1.
+int limbs_cmp (const limb_t* ap, const limb_t* bp, size_t n);
+
+//
+// Addition and subtraction.  The _n forms work on two arrays of
+// length n.  The general forms require an >= bn and write an limbs.
+// Each returns the carry or borrow out of the top limb.  The result
+// may alias either operand.
+//
+limb_t limbs_add_n (limb_t* rp, const limb_t* ap, const limb_t* bp,
+                    size_t n);
+limb_t limbs_sub_n (limb_t* rp, const limb_t* ap, const limb_t* bp,
+                    size_t n);
+limb_t limbs_add (limb_t* rp, const limb_t* ap, size_t an,
+                  const limb_t* bp, size_t bn);
+limb_t limbs_sub (limb_t* rp, const limb_t* ap, size_t an,
+                  const limb_t* bp, size_t bn);
+limb_t limbs_add_1 (limb_t* rp, const limb_t* ap, size_t an, limb_t b);
+limb_t limbs_sub_1 (limb_t* rp, const limb_t* ap, size_t an, limb_t b);
+
+//
+// Single limb multipliers.  mul_1 writes {ap,an}*b into rp;
+// addmul_1 adds it into rp and submul_1 subtracts it from rp.
+// All return the high limb, which for submul_1 is the borrow.
+//
+limb_t limbs_mul_1 (limb_t* rp, const limb_t* ap, size_t an, limb_t b);
+limb_t limbs_addmul_1 (limb_t* rp, const limb_t* ap, size_t an,
+                       limb_t b);
+limb_t limbs_submul_1 (limb_t* rp, const limb_t* ap, size_t an,
+                       limb_t b);
+
+//
+// Shifts by 0 < count < LIMB_BITS.  lshift returns the bits shifted
+// out of the top limb, rshift those shifted out of the bottom limb,
+// left justified.
+//
+limb_t limbs_lshift (limb_t* rp, const limb_t* ap, size_t an,
+                     unsigned count);
+limb_t limbs_rshift (limb_t* rp, const limb_t* ap, size_t an,
+                     unsigned count);
+
+//
+// limbs_mul -
+//    Full product of {ap,an} and {bp,bn} into rp, which must hold
+//    an+bn limbs and must not overlap either operand.  Picks
+//    schoolbook, Karatsuba, Toom-3, or a number theoretic transform
+//    by operand size.  A product of an array with itself is passed
+//    on to limbs_sqr.
+//
+void limbs_mul (limb_t* rp, const limb_t* ap, size_t an,
+                const limb_t* bp, size_t bn);
+
+//
+// limbs_sqr -
+//    Square of {ap,an} into rp, which must hold 2*an limbs and must
+//    not overlap ap.  Each algorithm has a squaring form that skips
+//    the repeated work: the cross products of the schoolbook method
+//    are formed once and doubled, the split methods square their
+//    pieces, and the transform is applied to the operand once.
+//
+void limbs_sqr (limb_t* rp, const limb_t* ap, size_t an);
+
+//
+// limbs_redc -
+//    Montgomery reduction.  Given an odd modulus {mp,n}, minv =
+//    -1/mp[0] mod 2^32, and a 2n-limb tp < m * 2^(32n), writes
+//    tp / 2^(32n) mod m to rp as n limbs.  tp is overwritten.
+//
+void limbs_redc (limb_t* rp, limb_t* tp, const limb_t* mp, size_t n,
+                 limb_t minv);
+
+//
+// limbs_divrem_1 -
+//    Divide {ap,an} by a single nonzero limb, writing an quotient
+//    limbs to qp, which may be ap.  Returns the remainder.
+//
+limb_t limbs_divrem_1 (limb_t* qp, const limb_t* ap, size_t an,
+                       limb_t d);
+
+//
+// limbs_divrem -
+//    Division of {ap,an} by {dp,dn}, where an >= dn >= 1 and the
+//    top limb of d is nonzero.  Writes an-dn+1 quotient limbs to qp
+//    and dn remainder limbs to rp.  Neither may overlap the inputs.
+//    Uses long division (Knuth, TAOCP vol 2, 4.3.1, Algorithm D)
+//    below limb_thresholds::div_burnikel and Burnikel-Ziegler
+//    recursive division above it.
+//
+void limbs_divrem (limb_t* qp, limb_t* rp, const limb_t* ap, size_t an,
+                   const limb_t* dp, size_t dn);
+
+#endif
+
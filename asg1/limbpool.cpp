@@ -0,0 +1,191 @@
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <mutex>
+#include <new>
+using namespace std;
+
+#include "limbpool.h"
+
+//
+// Size class c holds blocks of 2^c bytes.  Blocks too large for the
+// last class, which is CACHE_BYTES, go straight to the heap and are
+// never cached.  Each class keeps at most CACHE_BYTES worth of free
+// blocks, and never more than CACHE_BLOCKS of them, and a thread
+// keeps at most THREAD_CACHE_BYTES in all, so the cache stays small
+// next to the numbers it serves.
+//
+
+static const size_t MIN_CLASS = 5;
+static const size_t MAX_CLASS = 22;
+static const size_t CACHE_BYTES = size_t (1) << MAX_CLASS;
+static const size_t CACHE_BLOCKS = 64;
+static const size_t THREAD_CACHE_BYTES = size_t (16) << 20;
+
+static size_t size_class (size_t bytes) {
+   if (bytes <= size_t (1) << MIN_CLASS) return MIN_CLASS;
+   return sizeof (size_t) * CHAR_BIT - __builtin_clzl (bytes - 1);
+}
+
+//
+// free_lists -
+//    One thread's cached blocks, each list threaded through the
+//    first word of its free blocks, their total size, and the
+//    thread's counters.
+//    The counters are atomics because statistics reads them from
+//    another thread.  Only the owning thread writes them, so a
+//    relaxed load and store is enough to bump one, without a locked
+//    read-modify-write.  A thread's final counts are folded into
+//    retired when it exits.  Static ubigints can outlive the
+//    thread_local lists at exit, so once the lists are destroyed
+//    the closed flag, which has no destructor, sends later frees
+//    straight to the heap.
+//
+
+struct free_block { free_block* next; };
+
+struct tally {
+   atomic<size_t> requests {0};
+   atomic<size_t> reused {0};
+   atomic<size_t> heap_allocs {0};
+   atomic<size_t> heap_frees {0};
+};
+
+static void bump (atomic<size_t>& count) {
+   count.store (count.load (memory_order_relaxed) + 1,
+                memory_order_relaxed);
+}
+
+static limbpool::counters snapshot (const tally& counts) {
+   return {counts.requests.load (memory_order_relaxed),
+           counts.reused.load (memory_order_relaxed),
+           counts.heap_allocs.load (memory_order_relaxed),
+           counts.heap_frees.load (memory_order_relaxed)};
+}
+
+struct free_lists {
+   free_block* head[MAX_CLASS + 1] {};
+   size_t length[MAX_CLASS + 1] {};
+   size_t cached_bytes {0};
+   tally counts;
+   free_lists* prev {nullptr};
+   free_lists* next {nullptr};
+   free_lists();
+   ~free_lists();
+};
+
+//
+// Every live thread's lists are linked into the registry.  Worker
+// threads exit after static destructors have run, so the registry
+// is made only of trivially destructible pieces.
+//
+
+static mutex registry_lock;
+static free_lists* registry = nullptr;
+static limbpool::counters retired {};
+static thread_local bool lists_closed = false;
+static thread_local free_lists lists;
+
+static void add_counts (limbpool::counters& sum,
+                        const limbpool::counters& more) {
+   sum.requests += more.requests;
+   sum.reused += more.reused;
+   sum.heap_allocs += more.heap_allocs;
+   sum.heap_frees += more.heap_frees;
+}
+
+free_lists::free_lists() {
+   lock_guard<mutex> guard (registry_lock);
+   next = registry;
+   if (next != nullptr) next->prev = this;
+   registry = this;
+}
+
+free_lists::~free_lists() {
+   lists_closed = true;
+   for (free_block*& block: head) {
+      while (block != nullptr) {
+         free_block* next = block->next;
+         ::operator delete (block);
+         bump (counts.heap_frees);
+         block = next;
+      }
+   }
+   lock_guard<mutex> guard (registry_lock);
+   if (prev != nullptr) {
+      prev->next = next;
+   }else {
+      registry = next;
+   }
+   if (next != nullptr) next->prev = prev;
+   add_counts (retired, snapshot (counts));
+}
+
+void* limbpool::allocate (size_t bytes) {
+   size_t sclass = size_class (bytes);
+   if (lists_closed) return ::operator new (bytes);
+   free_lists& local = lists;
+   bump (local.counts.requests);
+   if (sclass > MAX_CLASS) {
+      bump (local.counts.heap_allocs);
+      return ::operator new (bytes);
+   }
+   free_block* block = local.head[sclass];
+   if (block == nullptr) {
+      bump (local.counts.heap_allocs);
+      return ::operator new (size_t (1) << sclass);
+   }
+   bump (local.counts.reused);
+   local.head[sclass] = block->next;
+   --local.length[sclass];
+   local.cached_bytes -= size_t (1) << sclass;
+   return block;
+}
+
+void limbpool::deallocate (void* block, size_t bytes) {
+   if (block == nullptr) return;
+   size_t sclass = size_class (bytes);
+   if (lists_closed) {
+      ::operator delete (block);
+      return;
+   }
+   free_lists& local = lists;
+   if (sclass <= MAX_CLASS) {
+      size_t limit = min (CACHE_BLOCKS, CACHE_BYTES >> sclass);
+      size_t block_bytes = size_t (1) << sclass;
+      if (local.length[sclass] < limit and local.cached_bytes
+          + block_bytes <= THREAD_CACHE_BYTES) {
+         free_block* freed = static_cast<free_block*> (block);
+         freed->next = local.head[sclass];
+         local.head[sclass] = freed;
+         ++local.length[sclass];
+         local.cached_bytes += block_bytes;
+         return;
+      }
+   }
+   bump (local.counts.heap_frees);
+   ::operator delete (block);
+}
+
+limbpool::counters limbpool::statistics() {
+   lock_guard<mutex> guard (registry_lock);
+   counters sum = retired;
+   for (const free_lists* thread_lists = registry;
+        thread_lists != nullptr; thread_lists = thread_lists->next) {
+      add_counts (sum, snapshot (thread_lists->counts));
+   }
+   return sum;
+}
+
+limbpool::counters limbpool::thread_statistics() {
+   if (lists_closed) return {};
+   return snapshot (lists.counts);
+}
+
+ostream& operator<< (ostream& out, const limbpool::counters& stats) {
+   return out << "limbpool: " << stats.requests << " requests, "
+              << stats.reused << " reused, "
+              << stats.heap_allocs << " heap allocations, "
+              << stats.heap_frees << " heap frees";
+}
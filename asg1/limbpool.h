@@ -0,0 +1,67 @@
+//
+// limbpool -
+//    Recycles the heap buffers behind ubigints and the temporaries
+//    of the arithmetic kernels.  Requests are rounded up to a power
+//    of two size class, and freed blocks are kept on per-thread
+//    free lists for the next request of the same class, so the
+//    inner loops of multiplication, division, and exponentiation
+//    stop going to the heap once they have warmed up.  A block may
+//    be freed by a different thread than allocated it.
+//
+// allocate, deallocate -
+//    As operator new and operator delete, but deallocate must be
+//    given the same byte count that allocate was.
+// statistics -
+//    Process-wide counts of requests, of those served from a free
+//    list, and of blocks taken from and returned to the heap.
+// thread_statistics -
+//    The same counts for the calling thread alone, without the
+//    lock, so that they can be read around a single operation.
+//
+// pool_allocator -
+//    A stateless standard allocator over limbpool, for vector and
+//    smallvec.
+//
+
+#ifndef __LIMBPOOL_H__
+#define __LIMBPOOL_H__
+
+#include <cstddef>
+#include <iostream>
+using namespace std;
+
+class limbpool {
+   public:
+      struct counters {
+         size_t requests;
+         size_t reused;
+         size_t heap_allocs;
+         size_t heap_frees;
+      };
+      static void* allocate (size_t bytes);
+      static void deallocate (void* block, size_t bytes);
+      static counters statistics();
+      static counters thread_statistics();
+};
+
+ostream& operator<< (ostream&, const limbpool::counters&);
+
+template <typename item_t>
+struct pool_allocator {
+   using value_type = item_t;
+   pool_allocator() = default;
+   template <typename other_t>
+   pool_allocator (const pool_allocator<other_t>&) {}
+   item_t* allocate (size_t count) {
+      return static_cast<item_t*> (
+             limbpool::allocate (count * sizeof (item_t)));
+   }
+   void deallocate (item_t* block, size_t count) {
+      limbpool::deallocate (block, count * sizeof (item_t));
+   }
+   bool operator== (const pool_allocator&) const { return true; }
+   bool operator!= (const pool_allocator&) const { return false; }
+};
+
+#endif
+
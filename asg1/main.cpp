@@ -1,7 +1,10 @@
+#include <array>
 #include <cassert>
+#include <cstdlib>
 #include <deque>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <utility>
 using namespace std;
@@ -9,69 +12,183 @@ using namespace std;
 #include <unistd.h>
 
 #include "bigint.h"
+#include "bytecode.h"
 #include "debug.h"
+#include "decimal.h"
 #include "iterstack.h"
 #include "libfns.h"
+#include "limbops.h"
+#include "limbpool.h"
+#include "profile.h"
 #include "scanner.h"
 #include "util.h"
+#include "workpool.h"
 
-using bigint_stack = iterstack<bigint>;
 
-void do_arith (bigint_stack& stack, const char oper) {
-   if (stack.size() < 2) throw ydc_exn ("stack empty");
-   bigint right = stack.top();
-   stack.pop();
+//
+// do_arith -
+//    The binary operators.  *, /, %, and ^ keep fraction digits as
+//    dc's scale rules give for k; G and the exponent of ^ use the
+//    integer parts of their operands.  A zero divisor is reported
+//    before anything is popped, so the stack is left as it was.
+//
+
+void do_arith (value_stack& stack, const char oper) {
+   need_numbers (stack, 2);
+   if ((oper == '/' or oper == '%')
+       and stack.top().number().is_zero()) {
+      throw ydc_exn (oper == '/' ? "divide by zero"
+                                 : "remainder by zero");
+   }
+   decimal right = stack.pop_top().number();
    DEBUGF ('d', "right = " << right);
-   bigint left = stack.top();
-   stack.pop();
+   decimal left = stack.pop_top().number();
    DEBUGF ('d', "left = " << left);
-   bigint result;
+   size_t scale = ydc_settings::scale;
    switch (oper) {
-      case '+': result = left + right; break;
-      case '-': result = left - right; break;
-      case '*': result = left * right; break;
-      case '/': result = left / right; break;
-      case '%': result = left % right; break;
-      case '^': result = pow (left, right); break;
+      case '+': left += right; break;
+      case '-': left -= right; break;
+      case '*': left = multiply (move (left), right, scale); break;
+      case '/': left = divide (move (left), right, scale); break;
+      case '%': left = remainder (move (left), right, scale); break;
+      case '^':
+         left = power (move (left), right.integer(), scale);
+         break;
+      case 'G': left = gcd (left.integer(), right.integer()); break;
       default: throw invalid_argument ("do_arith operator "s + oper);
    }
-   DEBUGF ('d', "result = " << result);
-   stack.push (result);
+   DEBUGF ('d', "result = " << left);
+   stack.push (move (left));
 }
 
-void do_clear (bigint_stack& stack, const char) {
+void do_clear (value_stack& stack, const char) {
    DEBUGF ('d', "");
    stack.clear();
 }
 
 
-void do_dup (bigint_stack& stack, const char) {
-   bigint top = stack.top();
-   DEBUGF ('d', top);
-   stack.push (top);
+void do_dup (value_stack& stack, const char) {
+   if (stack.size() == 0) throw ydc_exn ("stack empty");
+   DEBUGF ('d', stack.top());
+   stack.push (stack.top());
 }
 
-void do_printall (bigint_stack& stack, const char) {
-   if (stack.size() == 0) throw ydc_exn ("stack empty");
-   for (const auto& elem: stack) cout << elem << endl;
+//
+// do_modexp -
+//    dc's |: pops the modulus, the exponent, and the base, and
+//    pushes base^exponent % modulus.  Bad operands are reported
+//    before anything is popped, so the stack is left as it was.
+//
+
+void do_modexp (value_stack& stack, const char) {
+   need_numbers (stack, 3);
+   auto operands = stack.begin();
+   if (operands[0].number().integer().is_zero()) {
+      throw ydc_exn ("remainder by zero");
+   }
+   if (operands[1].number() < decimal (0)) {
+      throw ydc_exn ("negative exponent");
+   }
+   bigint modulus = stack.pop_top().number().integer();
+   bigint exponent = stack.pop_top().number().integer();
+   bigint base = stack.pop_top().number().integer();
+   stack.push (powmod (base, exponent, modulus));
 }
 
-void do_print (bigint_stack& stack, const char) {
+//
+// do_sqrt -
+//    dc's v, the square root truncated to the larger of the scale
+//    and the operand's own.  The gcd operator G, which dc lacks, is
+//    binary and so in do_arith.
+//
+
+void do_sqrt (value_stack& stack, const char) {
+   need_numbers (stack, 1);
+   if (stack.top().number() < decimal (0)) {
+      throw ydc_exn ("square root of negative number");
+   }
+   stack.push (square_root (stack.pop_top().number(),
+                            ydc_settings::scale));
+}
+
+//
+// do_radix -
+//    dc's i and o set the input and output radix from the top of
+//    the stack, and I and O push them.  Input is limited to 2
+//    through 16, since digits only go to F, and output to what
+//    fits in a limb.
+//
+
+void do_radix (value_stack& stack, const char oper) {
+   switch (oper) {
+      case 'I':
+         stack.push (bigint (ydc_settings::input_radix));
+         return;
+      case 'O':
+         stack.push (bigint (ydc_settings::output_radix));
+         return;
+   }
+   need_numbers (stack, 1);
+   bigint radix = stack.top().number().integer();
+   if (oper == 'i' and (radix < bigint (2) or bigint (16) < radix)) {
+      throw ydc_exn ("input base must be a number between 2 and 16 "
+                     "(inclusive)");
+   }
+   if (oper == 'o' and (radix < bigint (2)
+                        or bigint (UINT32_MAX) < radix)) {
+      throw ydc_exn ("output base must be a number between 2 and "
+                     + to_string (UINT32_MAX));
+   }
+   stack.pop_top();
+   if (oper == 'i') ydc_settings::input_radix = radix.low_word();
+               else ydc_settings::output_radix = radix.low_word();
+}
+
+//
+// do_scale -
+//    dc's k sets the number of fraction digits that *, /, %, ^, and
+//    v keep, and K pushes it.
+//
+
+void do_scale (value_stack& stack, const char oper) {
+   if (oper == 'K') {
+      stack.push (bigint (static_cast<long> (ydc_settings::scale)));
+      return;
+   }
+   need_numbers (stack, 1);
+   bigint scale = stack.top().number().integer();
+   if (scale < bigint (0) or bigint (UINT32_MAX) < scale) {
+      throw ydc_exn ("scale must be a nonnegative number");
+   }
+   stack.pop_top();
+   ydc_settings::scale = scale.low_word();
+}
+
+void do_printall (value_stack& stack, const char) {
    if (stack.size() == 0) throw ydc_exn ("stack empty");
-   cout << stack.top() << endl;
+   ostream& out = output();
+   for (const auto& elem: stack) out << elem << '\n';
 }
 
-void do_debug (bigint_stack& stack, const char) {
-   (void) stack; // SUPPRESS: warning: unused parameter 'stack'
-   cout << "Y not implemented" << endl;
+void do_print (value_stack& stack, const char) {
+   if (stack.size() == 0) throw ydc_exn ("stack empty");
+   output() << stack.top() << '\n';
 }
 
-class ydc_quit: public exception {};
-void do_quit (bigint_stack&, const char) {
-   throw ydc_quit();
+//
+// do_debug -
+//    Y writes the allocation and power cache counters, and the
+//    profile of the operators called so far when -P is on.
+//
+
+void do_debug (value_stack& stack, const char) {
+   (void) stack; // SUPPRESS: warning: unused parameter 'stack'
+   ostream& out = output();
+   out << limbpool::statistics() << '\n'
+       << pow_cache::statistics() << '\n';
+   if (profile::enabled) profile::report (out);
 }
 
-using function_t = void (*)(bigint_stack&, const char);
 using fn_hash = unordered_map<string,function_t>;
 fn_hash do_functions = {
    {"+"s, do_arith},
@@ -80,26 +197,104 @@ fn_hash do_functions = {
    {"/"s, do_arith},
    {"%"s, do_arith},
    {"^"s, do_arith},
+   {"|"s, do_modexp},
+   {"G"s, do_arith},
+   {"I"s, do_radix},
+   {"K"s, do_scale},
+   {"O"s, do_radix},
    {"Y"s, do_debug},
    {"c"s, do_clear},
    {"d"s, do_dup},
    {"f"s, do_printall},
+   {"i"s, do_radix},
+   {"k"s, do_scale},
+   {"o"s, do_radix},
    {"p"s, do_print},
-   {"q"s, do_quit},
+   {"v"s, do_sqrt},
 };
+
+void do_unimplemented (value_stack&, const char oper) {
+   throw ydc_exn (octal (oper) + " is unimplemented");
+}
+
+function_t lookup_function (char oper) {
+   static const auto table = [] {
+      array<function_t,256> result;
+      result.fill (do_unimplemented);
+      for (const auto& entry: do_functions) {
+         result[static_cast<unsigned char> (entry.first[0])]
+               = entry.second;
+      }
+      return result;
+   }();
+   return table[static_cast<unsigned char> (oper)];
+}
+
+bool batch_mode = false;
+bool piece_mode = false;
+
 //
 // scan_options
-//    Options analysis:  The only option is -Dflags. 
+//    Options analysis:
+//    -@flags       set debug flags.
+//    -b            batch mode: read and compile the whole script
+//                  before running it.
+//    -C bytes      cap the memory kept by the cache of large powers;
+//                  0 turns it off.
+//    -j threads    let large multiplications, and the pieces of -s,
+//                  use up to this many threads.
+//    -P            profile the operators, and write the profile to
+//                  the standard error at exit.
+//    -s            batch mode, with the script split at each c and
+//                  the pieces evaluated in parallel.
+//    -T name=limbs set an algorithm threshold (karatsuba, toom3,
+//                  ntt, burnikel, radix, parallel) to tune for the
+//                  host.
 //
 void scan_options (int argc, char** argv) {
    opterr = 0;
    for (;;) {
-      int option = getopt (argc, argv, "@:");
+      int option = getopt (argc, argv, "@:bC:j:PsT:");
       if (option == EOF) break;
       switch (option) {
          case '@':
             debugflags::setflags (optarg);
             break;
+         case 'b':
+            batch_mode = true;
+            break;
+         case 'C': {
+            string bytes = optarg;
+            if (bytes.empty() or bytes.find_first_not_of ("0123456789")
+                                 != string::npos) {
+               error() << "-C " << optarg << ": invalid size" << endl;
+            }else {
+               pow_cache::set_capacity (stoul (bytes));
+            }
+            break;
+         }
+         case 'j': {
+            int threads = atoi (optarg);
+            if (threads < 1) {
+               error() << "-j " << optarg << ": invalid thread count"
+                       << endl;
+            }else {
+               workpool::set_threads (threads);
+            }
+            break;
+         }
+         case 'P':
+            profile::enabled = true;
+            break;
+         case 's':
+            batch_mode = piece_mode = true;
+            break;
+         case 'T':
+            if (not limb_thresholds::set (optarg)) {
+               error() << "-T " << optarg << ": invalid threshold"
+                       << endl;
+            }
+            break;
          default:
             error() << "-" << static_cast<char> (optopt)
                     << ": invalid option" << endl;
@@ -112,43 +307,44 @@ void scan_options (int argc, char** argv) {
 }
 
 //
-// Main function.
+// Main function.  Output is buffered rather than flushed by every
+// print: it goes out when the buffer fills, when the scanner is
+// about to wait for more input, and at exit.
 //
 int main (int argc, char** argv) {
+   ios::sync_with_stdio (false);
    exec::execname (argv[0]);
    scan_options (argc, argv);
-   bigint_stack operand_stack;
-   scanner input;
+   value_stack operand_stack;
+   machine ydc (operand_stack, lookup_function);
    try {
+      if (batch_mode) {
+         script_text script (STDIN_FILENO);
+         program whole = compile (script.begin(), script.end(),
+                                  lookup_function);
+         if (piece_mode) run_pieces (whole, lookup_function);
+                    else ydc.run (whole);
+         throw ydc_quit();
+      }
+      scanner input;
+      input.tie (cout);
+      program line;
       for (;;) {
-         try {
-            token lexeme = input.scan();
-            switch (lexeme.symbol) {
-               case tsymbol::SCANEOF:
-                  throw ydc_quit();
-                  break;
-               case tsymbol::NUMBER:
-                  operand_stack.push (bigint (lexeme.lexinfo));
-                  break;
-               case tsymbol::OPERATOR: {
-                  fn_hash::const_iterator fn
-                           = do_functions.find (lexeme.lexinfo);
-                  if (fn == do_functions.end()) {
-                     throw ydc_exn (octal (lexeme.lexinfo[0])
-                                    + " is unimplemented");
-                  }
-                  fn->second (operand_stack, lexeme.lexinfo.at(0));
-                  break;
-                  }
-               default:
-                  assert (false);
-            }
-         }catch (ydc_exn& exn) {
-            cout << exn.what() << endl;
-         }
+         token lexeme = input.scan();
+         if (lexeme.symbol == tsymbol::SCANEOF) throw ydc_quit();
+         line.code.clear();
+         line.constants.clear();
+         line.literals.clear();
+         line.strings.clear();
+         compile (lexeme, line, lookup_function);
+         ydc.run (line);
       }
    }catch (ydc_quit&) {
       // Intentionally left empty.
 }
+   if (profile::enabled) {
+      cout.flush();
+      profile::report (cerr);
+   }
    return exec::status();
 }
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+using namespace std;
+
+#include "limbpool.h"
+#include "profile.h"
+
+bool profile::enabled = false;
+
+//
+// Operand sizes go in buckets of up to 1, 2, 4, ... limbs, the
+// last taking everything larger.
+//
+static const size_t SIZE_BUCKETS = 16;
+
+struct operator_counts {
+   atomic<uint64_t> calls;
+   atomic<uint64_t> total_ns;
+   atomic<uint64_t> max_ns;
+   atomic<uint64_t> requests;
+   atomic<uint64_t> heap_allocs;
+   array<atomic<uint64_t>,SIZE_BUCKETS> sizes;
+};
+
+// Static, and so zero before the first call.
+static array<operator_counts,256> counts;
+
+using profile_clock = chrono::steady_clock;
+
+static size_t size_bucket (value_stack& stack) {
+   size_t bits = 0;
+   auto value = stack.begin();
+   for (size_t index = 0; index < 2 and index < stack.size();
+        ++index, ++value) {
+      if (value->is_string()) continue;
+      bits = max (bits, value->number().bit_length());
+   }
+   size_t limbs = (bits + 31) / 32;
+   size_t bucket = 0;
+   while (bucket + 1 < SIZE_BUCKETS and size_t (1) << bucket < limbs) {
+      ++bucket;
+   }
+   return bucket;
+}
+
+static void record (operator_counts& entry, size_t bucket,
+                    const limbpool::counters& before,
+                    profile_clock::time_point start) {
+   uint64_t elapsed = chrono::duration_cast<chrono::nanoseconds>
+                      (profile_clock::now() - start).count();
+   limbpool::counters after = limbpool::thread_statistics();
+   entry.calls.fetch_add (1, memory_order_relaxed);
+   entry.total_ns.fetch_add (elapsed, memory_order_relaxed);
+   uint64_t longest = entry.max_ns.load (memory_order_relaxed);
+   while (elapsed > longest
+          and not entry.max_ns.compare_exchange_weak (
+                  longest, elapsed, memory_order_relaxed)) {
+   }
+   entry.requests.fetch_add (after.requests - before.requests,
+                             memory_order_relaxed);
+   entry.heap_allocs.fetch_add (after.heap_allocs - before.heap_allocs,
+                                memory_order_relaxed);
+   entry.sizes[bucket].fetch_add (1, memory_order_relaxed);
+}
+
+void profile::call (function_t function, value_stack& stack,
+                    char oper) {
+   operator_counts& entry = counts[static_cast<unsigned char> (oper)];
+   size_t bucket = size_bucket (stack);
+   limbpool::counters before = limbpool::thread_statistics();
+   profile_clock::time_point start = profile_clock::now();
+   try {
+      function (stack, oper);
+   }catch (...) {
+      record (entry, bucket, before, start);
+      throw;
+   }
+   record (entry, bucket, before, start);
+}
+
+//
+// One line per operator, and under it the nonzero size buckets,
+// each labeled with its largest size in limbs.
+//
+void profile::report (ostream& out) {
+   ostringstream text;
+   text << fixed << setprecision (3)
+        << "oper      calls    total ms      max ms    requests"
+           "  heap allocs\n";
+   for (size_t oper = 0; oper < counts.size(); ++oper) {
+      const operator_counts& entry = counts[oper];
+      uint64_t calls = entry.calls.load (memory_order_relaxed);
+      if (calls == 0) continue;
+      text << setw (4) << static_cast<char> (oper)
+           << setw (11) << calls
+           << setw (12) << entry.total_ns.load() / 1e6
+           << setw (12) << entry.max_ns.load() / 1e6
+           << setw (12) << entry.requests.load()
+           << setw (13) << entry.heap_allocs.load() << "\n"
+           << "          limbs";
+      for (size_t bucket = 0; bucket < SIZE_BUCKETS; ++bucket) {
+         uint64_t count = entry.sizes[bucket].load();
+         if (count == 0) continue;
+         if (bucket + 1 < SIZE_BUCKETS) {
+            text << " <=" << (size_t (1) << bucket);
+         }else {
+            text << " >" << (size_t (1) << (bucket - 1));
+         }
+         text << ": " << count;
+      }
+      text << "\n";
+   }
+   out << text.str();
+}
@@ -0,0 +1,37 @@
+//
+// profile -
+//    Measurements of the operator functions that machines call, for
+//    ydc -P and Y.  For each operator it counts the calls, their
+//    total and longest wall time, the limbpool requests and heap
+//    allocations made during them, and the sizes of the operands:
+//    the larger of the top two, in limbs, rounded up to a power of
+//    two.  Counters are relaxed atomics, so pieces running at once
+//    under -s can all record.  Allocations made by workpool
+//    threads on a call's behalf are not counted.
+//
+// enabled -
+//    Whether calls are recorded, set once at startup by -P.  A call
+//    costs one more branch when it is off.
+// call -
+//    Calls the function with the stack and operator, and records
+//    it, whether it returns or throws.
+// report -
+//    Writes the counts for each operator called so far.
+//
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <iostream>
+using namespace std;
+
+#include "bytecode.h"
+
+class profile {
+   public:
+      static bool enabled;
+      static void call (function_t, value_stack&, char oper);
+      static void report (ostream&);
+};
+
+#endif
@@ -1,4 +1,8 @@
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <locale>
 #include <stdexcept>
@@ -9,22 +13,95 @@ using namespace std;
 #include "scanner.h"
 #include "debug.h"
 
-char scanner::get() {
-   if (not good()) throw runtime_error ("scanner::get() past EOF"); 
-   char currchar = nextchar;
-   nextchar = instream.get();
-   return currchar;
+static const size_t BLOCK_SIZE = 1 << 16;
+
+//
+// Operators followed by a register name, and the comparisons that
+// may follow a !, which are then followed by a register name.
+//
+static const string_view REGISTER_OPERATORS = "sSlL<>=";
+static const string_view COMPARISONS = "<>=";
+
+//
+// dc takes A-F as digits whatever the input radix.  A number may
+// also have one point, anywhere in it.
+//
+static bool is_digit (char symbol) {
+   return isdigit (static_cast<unsigned char> (symbol))
+       or (symbol >= 'A' and symbol <= 'F');
+}
+
+scanner::scanner (int fd): fd(fd) {
+}
+
+//
+// Moves the bytes from keep to the end of the buffer to the front,
+// reads more after them, and moves keep to match.  Returns false at
+// end of file or on a read error.
+//
+bool scanner::fill (const char*& keep) {
+   if (fd < 0) return false;
+   if (tied != nullptr) tied->flush();
+   size_t kept = limit - keep;
+   if (kept > 0) memmove (buffer.data(), keep, kept);
+   if (buffer.size() < kept + BLOCK_SIZE) {
+      buffer.resize (max (2 * buffer.size(), kept + BLOCK_SIZE));
+   }
+   ssize_t bytes;
+   do {
+      bytes = read (fd, buffer.data() + kept, buffer.size() - kept);
+   }while (bytes < 0 and errno == EINTR);
+   keep = buffer.data();
+   next = keep + kept;
+   limit = next + max<ssize_t> (bytes, 0);
+   return bytes > 0;
 }
 
 token scanner::scan() {
-   while (good() and isspace (nextchar)) get();
-   if (not good()) return {tsymbol::SCANEOF};
-   if (nextchar == '_' or isdigit (nextchar)) {
-      token result {tsymbol::NUMBER, {get()}};
-      while (good() and isdigit (nextchar)) result.lexinfo += get();
-      return result;
+   for (;;) {
+      while (next != limit and isspace (static_cast<unsigned char>
+                                        (*next))) ++next;
+      if (next != limit) break;
+      const char* keep = next;
+      if (not fill (keep)) return {tsymbol::SCANEOF};
+   }
+   const char* start = next++;
+   if (*start == '_' or *start == '.' or is_digit (*start)) {
+      bool point = *start == '.';
+      for (;;) {
+         for (; next != limit; ++next) {
+            if (*next == '.' and not point) point = true;
+            else if (not is_digit (*next)) break;
+         }
+         if (next != limit or not fill (start)) break;
+      }
+      return {tsymbol::NUMBER, string_view (start, next - start)};
+   }
+   if (*start == '[') {
+      size_t depth = 1;
+      for (;;) {
+         for (; next != limit; ++next) {
+            if (*next == '[') ++depth;
+            else if (*next == ']' and --depth == 0) break;
+         }
+         if (next != limit or not fill (start)) break;
+      }
+      string_view text (start + 1, next - start - 1);
+      if (next != limit) ++next;
+      return {tsymbol::STRING, text};
+   }
+   bool negated = *start == '!';
+   if (negated
+       or REGISTER_OPERATORS.find (*start) != string_view::npos) {
+      if (next != limit or fill (start)) {
+         bool compares = COMPARISONS.find (*next) != string_view::npos;
+         if (not negated or compares) ++next;
+         if (negated and compares and (next != limit or fill (start))) {
+            ++next;
+         }
+      }
    }
-   return {tsymbol::OPERATOR, {get()}};
+   return {tsymbol::OPERATOR, string_view (start, next - start)};
 }
 
 ostream& operator<< (ostream& out, tsymbol symbol) {
@@ -36,6 +113,7 @@ ostream& operator<< (ostream& out, tsymbol symbol) {
    static const unordered_map<tsymbol,string,hasher> map {
       {tsymbol::NUMBER  , "NUMBER"  },
       {tsymbol::OPERATOR, "OPERATOR"},
+      {tsymbol::STRING  , "STRING"  },
       {tsymbol::SCANEOF , "SCANEOF" },
    };
    return out << map.at(symbol);
@@ -2,29 +2,58 @@
 #define __SCANNER_H__
 
 #include <iostream>
+#include <string_view>
 #include <utility>
+#include <vector>
 using namespace std;
 
+#include <unistd.h>
+
 #include "debug.h"
 
-enum class tsymbol {SCANEOF, NUMBER, OPERATOR};
+enum class tsymbol {SCANEOF, NUMBER, OPERATOR, STRING};
+
+//
+// token -
+//    lexinfo views the scanner's buffer and is only good until the
+//    next call to scan.
+//
 
 struct token {
    tsymbol symbol;
-   string lexinfo;
-   token (tsymbol sym, const string& lex = string()):
+   string_view lexinfo;
+   token (tsymbol sym, string_view lex = string_view()):
           symbol(sym), lexinfo(lex){
    }
 };
 
+//
+// scanner -
+//    Reads its file descriptor with read(2) in large blocks and
+//    scans with pointers over the block, so no character is copied
+//    on the way to its token.  A number that runs off the end of a
+//    block is kept and the block refilled behind it, growing the
+//    buffer if the number is longer than the buffer.  Strings are
+//    kept the same way.  A string's lexinfo is its text without the
+//    brackets, and a register operator's includes the register.
+//    The second constructor scans text already in memory, such as a
+//    whole script, and never reads.  A tied stream is flushed before
+//    each read, as cin flushes cout.
+//
+
 class scanner {
    private:
-      istream& instream;
-      int nextchar {instream.get()};
-      bool good() { return nextchar != EOF; }
-      char get();
+      int fd {-1};
+      ostream* tied {nullptr};
+      vector<char> buffer;
+      const char* next {nullptr};
+      const char* limit {nullptr};
+      bool fill (const char*& keep);
    public:
-      scanner (istream& instream = cin): instream(instream) {}
+      explicit scanner (int fd = STDIN_FILENO);
+      scanner (const char* begin, const char* end):
+               next(begin), limit(end) {}
+      void tie (ostream& out) { tied = &out; }
       token scan();
 };
 
@@ -0,0 +1,214 @@
+//
+// smallvec -
+//    A vector of trivially copyable items which keeps its first
+//    inline_size items inside the object itself and only goes to
+//    the heap when it grows past that.  Small values therefore cost
+//    no allocation to create, copy, or destroy.
+//
+// Only the subset of the std::vector interface that ubigint needs
+// is provided.  As with vector, resize value-initializes new items.
+// Heap buffers come from alloc_t, which must be stateless.
+// Moving from a heap-backed smallvec steals its buffer; moving from
+// an inline one copies the items.
+//
+
+#ifndef __SMALLVEC_H__
+#define __SMALLVEC_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+using namespace std;
+
+template <typename item_t, size_t inline_size,
+          typename alloc_t = allocator<item_t>>
+class smallvec {
+   static_assert (is_trivially_copyable<item_t>::value,
+                  "smallvec items are moved with memcpy");
+   private:
+      item_t* data_ {inline_};
+      size_t size_ {0};
+      size_t capacity_ {inline_size};
+      item_t inline_[inline_size];
+      bool is_inline() const { return data_ == inline_; }
+      void release() {
+         if (not is_inline()) alloc_t().deallocate (data_, capacity_);
+      }
+      void grow (size_t min_capacity);
+   public:
+      using value_type = item_t;
+      using iterator = item_t*;
+      using const_iterator = const item_t*;
+
+      smallvec() = default;
+      explicit smallvec (size_t count) { resize (count); }
+      smallvec (size_t count, const item_t& item) {
+         assign (count, item);
+      }
+      smallvec (const smallvec& that);
+      smallvec (smallvec&& that) noexcept;
+      template <typename iter_t, typename = typename enable_if<
+                not is_integral<iter_t>::value>::type>
+      smallvec (iter_t first, iter_t last) { assign (first, last); }
+      smallvec& operator= (const smallvec& that);
+      smallvec& operator= (smallvec&& that) noexcept;
+      ~smallvec() { release(); }
+
+      size_t size() const { return size_; }
+      size_t capacity() const { return capacity_; }
+      bool empty() const { return size_ == 0; }
+      item_t* data() { return data_; }
+      const item_t* data() const { return data_; }
+      iterator begin() { return data_; }
+      iterator end() { return data_ + size_; }
+      const_iterator begin() const { return data_; }
+      const_iterator end() const { return data_ + size_; }
+      item_t& operator[] (size_t index) { return data_[index]; }
+      const item_t& operator[] (size_t index) const {
+         return data_[index];
+      }
+      item_t& back() { return data_[size_ - 1]; }
+      const item_t& back() const { return data_[size_ - 1]; }
+
+      void clear() { size_ = 0; }
+      void reserve (size_t count) {
+         if (count > capacity_) grow (count);
+      }
+      void resize (size_t count);
+      void push_back (const item_t& item);
+      void pop_back() { --size_; }
+      template <typename iter_t>
+      void assign (iter_t first, iter_t last);
+      void assign (size_t count, const item_t& item);
+      iterator erase (iterator first, iterator last);
+      void swap (smallvec& that) noexcept;
+
+      bool operator== (const smallvec& that) const {
+         return size_ == that.size_
+            and equal (begin(), end(), that.begin());
+      }
+};
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+void smallvec<item_t,inline_size,alloc_t>::grow (size_t min_capacity) {
+   size_t new_capacity = max (min_capacity, 2 * capacity_);
+   item_t* new_data = alloc_t().allocate (new_capacity);
+   memcpy (new_data, data_, size_ * sizeof (item_t));
+   release();
+   data_ = new_data;
+   capacity_ = new_capacity;
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+smallvec<item_t,inline_size,alloc_t>::smallvec (const smallvec& that) {
+   assign (that.begin(), that.end());
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+smallvec<item_t,inline_size,alloc_t>::smallvec (smallvec&& that)
+      noexcept {
+   *this = move (that);
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+smallvec<item_t,inline_size,alloc_t>&
+smallvec<item_t,inline_size,alloc_t>::operator= (const smallvec& that) {
+   if (this != &that) assign (that.begin(), that.end());
+   return *this;
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+smallvec<item_t,inline_size,alloc_t>&
+smallvec<item_t,inline_size,alloc_t>::operator= (smallvec&& that)
+      noexcept {
+   if (this == &that) return *this;
+   if (that.is_inline()) {
+      // Keep our own buffer, which is at least as large.
+      memcpy (data_, that.data_, that.size_ * sizeof (item_t));
+      size_ = that.size_;
+   }else {
+      release();
+      data_ = that.data_;
+      size_ = that.size_;
+      capacity_ = that.capacity_;
+      that.data_ = that.inline_;
+      that.capacity_ = inline_size;
+   }
+   that.size_ = 0;
+   return *this;
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+void smallvec<item_t,inline_size,alloc_t>::resize (size_t count) {
+   if (count > capacity_) grow (count);
+   if (count > size_) {
+      fill (data_ + size_, data_ + count, item_t());
+   }
+   size_ = count;
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+void
+smallvec<item_t,inline_size,alloc_t>::push_back (const item_t& item) {
+   if (size_ == capacity_) {
+      item_t copy = item; // item may live in the buffer being freed.
+      grow (size_ + 1);
+      data_[size_++] = copy;
+   }else {
+      data_[size_++] = item;
+   }
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+template <typename iter_t>
+void
+smallvec<item_t,inline_size,alloc_t>::assign (iter_t first,
+                                              iter_t last) {
+   size_t count = distance (first, last);
+   if (count > capacity_) {
+      release();
+      data_ = inline_;
+      capacity_ = inline_size;
+      size_ = 0;
+      grow (count);
+   }
+   copy (first, last, data_);
+   size_ = count;
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+void smallvec<item_t,inline_size,alloc_t>::assign (size_t count,
+                                                  const item_t& item) {
+   size_ = 0;
+   resize (count);
+   fill (data_, data_ + count, item);
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+typename smallvec<item_t,inline_size,alloc_t>::iterator
+smallvec<item_t,inline_size,alloc_t>::erase (iterator first,
+                                             iterator last) {
+   iterator tail = copy (last, end(), first);
+   size_ = tail - data_;
+   return first;
+}
+
+template <typename item_t, size_t inline_size, typename alloc_t>
+void
+smallvec<item_t,inline_size,alloc_t>::swap (smallvec& that) noexcept {
+   if (is_inline() or that.is_inline()) {
+      smallvec temp (move (that));
+      that = move (*this);
+      *this = move (temp);
+   }else {
+      std::swap (data_, that.data_);
+      std::swap (size_, that.size_);
+      std::swap (capacity_, that.capacity_);
+   }
+}
+
+#endif
+
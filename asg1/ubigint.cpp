@@ -1,401 +1,775 @@
+
+#include <algorithm>
 #include <cctype>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <stack>
 #include <stdexcept>
-#include <cmath>
 #include <vector>
-#include <sstream>
 using namespace std;
 
 #include "ubigint.h"
 #include "debug.h"
+#include "limbops.h"
+
+// Largest power of 10 that fits in one limb, used for radix
+// conversion nine decimal digits at a time.
+const uint32_t DEC_CHUNK = 1000000000;
+const int DEC_CHUNK_DIGITS = 9;
+
+// Smallest operand for which the radix conversion splits; below it
+// the halves would not shrink.
+const size_t MIN_RADIX_LIMBS = 4;
 
-//used to check length of vectors
-const int THIS = 0;
-const int THAT = 1;
-const int EQLN = 2;
+// Most decimal digits that always fit in a 64-bit word.
+const size_t WORD_DIGITS = 19;
+
+void ubigint::trim() {
+   while (ubig_value.size() > 0 and ubig_value.back() == 0) {
+      ubig_value.pop_back();
+   }
+}
+
+ubigint::udigit2_t ubigint::word() const {
+   udigit2_t result = 0;
+   if (ubig_value.size() > 1) result = udigit2_t (ubig_value[1]) << 32;
+   if (ubig_value.size() > 0) result |= ubig_value[0];
+   return result;
+}
+
+void ubigint::set_words (udigit2_t low, udigit2_t high) {
+   ubig_value.resize (INLINE_LIMBS);
+   ubig_value[0] = static_cast<udigit_t> (low);
+   ubig_value[1] = static_cast<udigit_t> (low >> UDIGIT_BITS);
+   ubig_value[2] = static_cast<udigit_t> (high);
+   ubig_value[3] = static_cast<udigit_t> (high >> UDIGIT_BITS);
+   trim();
+}
 
 ubigint::ubigint (unsigned long that) {
-   stringstream ss;
-   string that_;
-   ss << that;
-   ss >> that_;
-
-   for (char digit: that_) {
-      ubigvalue_t::iterator it = ubig_value.begin();
-      ubig_value.insert(it, digit);
-      if (not isdigit(digit)) {
-         throw invalid_argument ("ubigint::ubigint(" + that_ + ")");
-      }
+   while (that > 0) {
+      ubig_value.push_back (static_cast<udigit_t> (that));
+      that >>= UDIGIT_BITS;
    }
 }
 
-ubigint::ubigint (const string& that) {
+ubigint::ubigint (string_view that) {
    for (char digit: that) {
-      ubigvalue_t::iterator it = ubig_value.begin();
-      ubig_value.insert(it, digit);
       if (not isdigit (digit)) {
-         throw invalid_argument ("ubigint::ubigint(" + that + ")");
+         throw invalid_argument ("ubigint::ubigint(" + string (that)
+                                 + ")");
       }
- 
-  }
+   }
+   *this = from_decimal (that.data(), that.size());
 }
 
-ubigint ubigint::operator+ (const ubigint& that) const {
-   ubigint ubig_int;
-   int loop_len;
-   int carry = 0;
-   int rem;
-   int longer_num_len; 
-   int longer_num = EQLN; // set flag to equal length
-   int thisnum, thatnum;
-   int sum;
-   unsigned char char_rem;
-   int i;
-
-   if (this->ubig_value.size() < that.ubig_value.size()) {
-      longer_num_len = that.ubig_value.size();
-      loop_len = this->ubig_value.size(); // endLoop&bringxtrNumsDown
-      longer_num = THAT;
-   }
-   else if (this->ubig_value.size() > that.ubig_value.size()) {
-      longer_num_len = this->ubig_value.size();
-      loop_len = that.ubig_value.size();
-      longer_num = THIS;
-   }
-   else {
-      longer_num_len = this->ubig_value.size();
-      loop_len = this->ubig_value.size();
-      longer_num = EQLN;
-   }
-
-   for (i = 0; i < loop_len; ++i) {
-      thisnum = this->ubig_value[i] - '0'; 
-      thatnum = that.ubig_value[i]  - '0';
-      sum = thisnum + thatnum + carry;
-      rem = sum % 10; // get single digit
-      char_rem = rem + '0';
-      if (sum < 10) {
-         carry = 0;
-         ubig_int.ubig_value.push_back(char_rem);
-      }
-      else {
-         carry = 1;
-         ubig_int.ubig_value.push_back(char_rem);
-      }   
-   }
-
-   if (longer_num == THIS) {
-      for (i = loop_len; i < longer_num_len; ++i) {
-         thisnum = this->ubig_value[i] - '0';
-         sum = thisnum + carry;
-         rem = sum % 10;
-         char_rem = rem + '0';
-         if (sum < 10) {
-            carry = 0;
-            ubig_int.ubig_value.push_back(char_rem);
-         }
-         else {
-            carry = 1;
-            ubig_int.ubig_value.push_back(char_rem);
-         }
-      }
+ubigint::ubigint (string_view that, unsigned radix) {
+   if (radix == 10 and that.find_first_of ("ABCDEF") == that.npos) {
+      *this = ubigint (that);
+      return;
    }
-   else if (longer_num == THAT) {
-      for (i = loop_len; i < longer_num_len; ++i) {
-         thisnum = that.ubig_value[i] - '0';
-         sum = thisnum + carry;
-         rem = sum % 10;
-         char_rem = rem + '0';
-         if (sum < 10) {
-            carry = 0;
-            ubig_int.ubig_value.push_back(char_rem);
-         }
-         else {
-            carry = 1;
-            ubig_int.ubig_value.push_back(char_rem);
-         }
+   for (char digit: that) {
+      if (not isdigit (digit) and not (digit >= 'A' and digit <= 'F')) {
+         throw invalid_argument ("ubigint::ubigint(" + string (that)
+                                 + ")");
       }
    }
-   // else longer_num == EQLN   
+   *this = from_radix (that, radix);
+}
 
-   if (carry == 1) {
-      unsigned char char_carry = carry + '0';
-      ubig_int.ubig_value.push_back(char_carry);
+ubigint& ubigint::operator+= (const ubigint& that) {
+   if (is_word() and that.is_word()) {
+      udigit2_t sum;
+      bool carry = __builtin_add_overflow (word(), that.word(), &sum);
+      set_words (sum, carry);
+      return *this;
    }
-
-   return ubig_int;;
+   // Take the sizes first: that may be *this, and resizing would
+   // change its size too.
+   size_t this_size = ubig_value.size();
+   size_t that_size = that.ubig_value.size();
+   size_t longest = max (this_size, that_size);
+   ubig_value.resize (longest + 1);
+   const udigit_t* that_data = that.ubig_value.data();
+   udigit_t* data = ubig_value.data();
+   udigit_t carry = this_size >= that_size
+         ? limbs_add (data, data, this_size, that_data, that_size)
+         : limbs_add (data, that_data, that_size, data, this_size);
+   ubig_value[longest] = carry;
+   trim();
+   return *this;
 }
 
-ubigint ubigint::operator- (const ubigint& that) const {
+ubigint& ubigint::operator-= (const ubigint& that) {
    if (*this < that) throw domain_error ("ubigint::operator-(a<b)");
+   if (is_word()) {
+      set_words (word() - that.word());
+      return *this;
+   }
+   limbs_sub (ubig_value.data(), ubig_value.data(), ubig_value.size(),
+              that.ubig_value.data(), that.ubig_value.size());
+   trim();
+   return *this;
+}
 
-   ubigint ubig_int;
-   ubigvalue_t this_vec = this->ubig_value;
-   ubigvalue_t that_vec = that.ubig_value;   
-   int thisnum, thatnum;
-   int diff;
-   int carry = 0;
-   unsigned char char_diff;
-   unsigned char lead_zero = '0';
-   int i;
-   if (this->ubig_value.size() < that.ubig_value.size()) {
-      for (i = this->ubig_value.size(); 
-            i < that.ubig_value.size(); ++i) {
-         this_vec.push_back(lead_zero);
-      }
+ubigint& ubigint::subtract_from (const ubigint& that) {
+   if (that < *this) throw domain_error ("ubigint::operator-(a<b)");
+   if (that.is_word()) {
+      set_words (that.word() - word());
+      return *this;
    }
-   else if (this->ubig_value.size() > that.ubig_value.size()) {
-      for (i = that.ubig_value.size(); 
-            i < this->ubig_value.size(); ++i) {
-         that_vec.push_back(lead_zero); 
-      }
+   size_t this_size = ubig_value.size();
+   ubig_value.resize (that.ubig_value.size());
+   udigit_t* data = ubig_value.data();
+   udigit_t borrow = limbs_sub_n (data, that.ubig_value.data(), data,
+                                  this_size);
+   limbs_sub_1 (data + this_size, that.ubig_value.data() + this_size,
+                that.ubig_value.size() - this_size, borrow);
+   trim();
+   return *this;
+}
+
+//
+// The product and quotient cannot be formed in place, so they are
+// built in a scratch vector and swapped in, and the old storage
+// becomes the thread's spare for the next call.  Each call takes
+// the spare out of its thread_local slot for as long as it uses
+// it, so a call nested on the same thread, by a pool task run
+// while this one waits, finds the slot empty and allocates rather
+// than writing over a buffer in use.
+//
+
+ubigint& ubigint::operator*= (const ubigint& that) {
+   if (is_word() and that.is_word()) {
+      unsigned __int128 product = word();
+      product *= that.word();
+      set_words (static_cast<udigit2_t> (product),
+                 static_cast<udigit2_t> (product >> 64));
+      return *this;
    }
+   static thread_local ubigvalue_t spare;
+   ubigvalue_t product;
+   product.swap (spare);
+   product.resize (ubig_value.size() + that.ubig_value.size());
+   if (this == &that) {
+      limbs_sqr (product.data(), ubig_value.data(), ubig_value.size());
+   }else {
+      limbs_mul (product.data(), ubig_value.data(), ubig_value.size(),
+                 that.ubig_value.data(), that.ubig_value.size());
+   }
+   ubig_value.swap (product);
+   spare.swap (product);
+   trim();
+   return *this;
+}
 
-   for (i = 0; i < this_vec.size(); ++i) {
-      thisnum = this_vec[i] - '0';
-      thatnum = that_vec[i] - '0';
+void ubigint::divrem (const ubigint& dividend, const ubigint& divisor,
+                      ubigvalue_t& quotient, ubigvalue_t& remainder) {
+   const ubigvalue_t& num = dividend.ubig_value;
+   const ubigvalue_t& den = divisor.ubig_value;
+   if (den.empty()) throw domain_error ("udivide by zero");
+   if (dividend < divisor) {
+      quotient.clear();
+      remainder.assign (num.begin(), num.end());
+      return;
+   }
+   quotient.resize (num.size() - den.size() + 1);
+   remainder.resize (den.size());
+   limbs_divrem (quotient.data(), remainder.data(),
+                 num.data(), num.size(), den.data(), den.size());
+   quotient.resize (limbs_normalize (quotient.data(), quotient.size()));
+   remainder.resize (limbs_normalize (remainder.data(),
+                                      remainder.size()));
+}
 
-      diff = thisnum - thatnum + carry;
-      if (diff < 0) {
-         diff += 10;
-         carry = -1;
-      }
-      else {
-         carry = 0;
-      }
-      char_diff = diff + '0';
-      ubig_int.ubig_value.push_back(char_diff);
+ubigint& ubigint::operator/= (const ubigint& that) {
+   if (is_word() and that.is_word() and not that.is_zero()) {
+      set_words (word() / that.word());
+      return *this;
    }
+   static thread_local ubigvalue_t spare_quotient;
+   static thread_local ubigvalue_t spare_remainder;
+   ubigvalue_t quotient;
+   ubigvalue_t remainder;
+   quotient.swap (spare_quotient);
+   remainder.swap (spare_remainder);
+   divrem (*this, that, quotient, remainder);
+   ubig_value.swap (quotient);
+   spare_quotient.swap (quotient);
+   spare_remainder.swap (remainder);
+   return *this;
+}
 
-   for (i = ubig_int.ubig_value.size() - 1; i >= 0; --i) {
-      if (ubig_int.ubig_value.size() == 1 ||
-          ubig_int.ubig_value[i-1] == '\0') {
-         break;
-      }
-      else if (ubig_int.ubig_value[i] == '0' 
-                && ubig_int.ubig_value[i-1] != '0') {
-         ubig_int.ubig_value.pop_back();
-      }
-      else if (ubig_int.ubig_value[i] == '0' 
-                && ubig_int.ubig_value[i-1] == '0') {
-         ubig_int.ubig_value.pop_back();
-         break;
-      }
-      else break;
-   } 
+ubigint& ubigint::operator%= (const ubigint& that) {
+   if (is_word() and that.is_word() and not that.is_zero()) {
+      set_words (word() % that.word());
+      return *this;
+   }
+   static thread_local ubigvalue_t spare_quotient;
+   static thread_local ubigvalue_t spare_remainder;
+   ubigvalue_t quotient;
+   ubigvalue_t remainder;
+   quotient.swap (spare_quotient);
+   remainder.swap (spare_remainder);
+   divrem (*this, that, quotient, remainder);
+   ubig_value.swap (remainder);
+   spare_quotient.swap (quotient);
+   spare_remainder.swap (remainder);
+   return *this;
+}
+
+ubigint& ubigint::operator<<= (size_t bits) {
+   if (ubig_value.empty()) return *this;
+   size_t limbs = bits / UDIGIT_BITS;
+   unsigned shift = bits % UDIGIT_BITS;
+   size_t old_size = ubig_value.size();
+   ubig_value.resize (old_size + limbs + 1);
+   udigit_t* data = ubig_value.data();
+   if (limbs > 0) {
+      copy_backward (data, data + old_size, data + old_size + limbs);
+      fill (data, data + limbs, 0);
+   }
+   data[old_size + limbs] = shift == 0 ? 0
+         : limbs_lshift (data + limbs, data + limbs, old_size, shift);
+   trim();
+   return *this;
+}
+
+ubigint& ubigint::operator>>= (size_t bits) {
+   size_t limbs = bits / UDIGIT_BITS;
+   unsigned shift = bits % UDIGIT_BITS;
+   if (limbs >= ubig_value.size()) {
+      ubig_value.clear();
+      return *this;
+   }
+   ubig_value.erase (ubig_value.begin(), ubig_value.begin() + limbs);
+   if (shift > 0) {
+      limbs_rshift (ubig_value.data(), ubig_value.data(),
+                    ubig_value.size(), shift);
+   }
+   trim();
+   return *this;
+}
+
+size_t ubigint::bit_length() const {
+   if (ubig_value.empty()) return 0;
+   return ubig_value.size() * UDIGIT_BITS
+        - __builtin_clz (ubig_value.back());
+}
+
+ubigint ubigint::operator+ (const ubigint& that) const {
+   ubigint result {*this};
+   return result += that;
+}
 
-   return ubig_int;
+ubigint ubigint::operator- (const ubigint& that) const {
+   ubigint result {*this};
+   return result -= that;
 }
 
 ubigint ubigint::operator* (const ubigint& that) const {
-   ubigint ubig_int;   
-
-   vector<unsigned char> product(this->ubig_value.size() 
-                            + that.ubig_value.size(), '0');
-   
-   int c, d;
-   int i, j;
-   for (i = 0; i < this->ubig_value.size(); ++i) {
-      c = 0;
-      for (j = 0; j < that.ubig_value.size(); ++j) {
-         d = (product[i + j] - '0') + ((this->ubig_value[i] - '0')
-             * (that.ubig_value[j] - '0')) + c;
-         product[i + j] = ((d % 10) + '0');
-         c = floor(d / 10);
-      }
-      product[i + that.ubig_value.size()] = c + '0';
+   if (is_word() and that.is_word()) {
+      ubigint result {*this};
+      return result *= that;
    }
-   
-   ubig_int.ubig_value = product;
+   ubigint result;
+   result.ubig_value.resize (ubig_value.size()
+                             + that.ubig_value.size());
+   if (this == &that) {
+      limbs_sqr (result.ubig_value.data(),
+                 ubig_value.data(), ubig_value.size());
+   }else {
+      limbs_mul (result.ubig_value.data(),
+                 ubig_value.data(), ubig_value.size(),
+                 that.ubig_value.data(), that.ubig_value.size());
+   }
+   result.trim();
+   return result;
+}
 
-   for (i = ubig_int.ubig_value.size() - 1; i >= 0; --i) {
-      if (ubig_int.ubig_value.size() == 1 ||
-          ubig_int.ubig_value[i - 1] == '\0') {
-         break;
-      }
-      else if (ubig_int.ubig_value[i] == '0'
-                && ubig_int.ubig_value[i - 1] != '0') {
-         ubig_int.ubig_value.pop_back();
-      }
-      else if (ubig_int.ubig_value[i] == '0'
-                && ubig_int.ubig_value[i - 1] == '0') {
-         ubig_int.ubig_value.pop_back();
-         break;
-      }
-      else break;
-   }
- 
-   return ubig_int;
-}
-
-void ubigint::multiply_by_2() {
-   ubigint ubig_int;
-   vector<unsigned char> product(this->ubig_value.size() + 1, '0');
-   vector<unsigned char> that;
-   that.push_back('2');
-
-   int c, d;
-   int i, j;
-   for (i = 0; i < this->ubig_value.size(); ++i) {
-      c = 0;
-      for (j = 0; j < that.size(); ++j) {
-         d = (product[i + j] - '0') + ((this->ubig_value[i] - '0') 
-             * (that[j] - '0')) + c;
-         product[i + j] = ((d % 10) + '0');
-         c = floor(d / 10);
+quo_rem udivide (const ubigint& dividend, const ubigint& divisor) {
+   quo_rem result;
+   ubigint::divrem (dividend, divisor, result.quotient.ubig_value,
+                    result.remainder.ubig_value);
+   return result;
+}
+
+ubigint upowmod (const ubigint& base, const ubigint& exponent,
+                 const ubigint& modulus) {
+   using ubigvalue_t = ubigint::ubigvalue_t;
+   if (modulus.is_zero()) throw domain_error ("upowmod by zero");
+   size_t bits = exponent.bit_length();
+   ubigint result = ubigint (1) % modulus;
+   ubigint reduced = base % modulus;
+
+   if (modulus.is_word()) {
+      using uword = unsigned __int128;
+      uword m = modulus.word();
+      uword x = result.word();
+      uword b = reduced.word();
+      for (size_t index = bits; index-- > 0; ) {
+         x = x * x % m;
+         if (exponent.bit (index)) x = x * b % m;
       }
-      product[i + that.size()] = c + '0';
+      result.set_words (static_cast<ubigint::udigit2_t> (x));
+      return result;
    }
-   
-   ubig_int.ubig_value = product;   
 
-   for (i = ubig_int.ubig_value.size() - 1; i >= 0; --i) {
-      if (ubig_int.ubig_value.size() == 1 ||
-          ubig_int.ubig_value[i-1] == '\0') {
-         break;
-      }
-      else if (ubig_int.ubig_value[i] == '0'
-                && ubig_int.ubig_value[i - 1] != '0') {
-         ubig_int.ubig_value.pop_back();
+   if (not modulus.is_odd()) {
+      for (size_t index = bits; index-- > 0; ) {
+         result *= result;
+         result %= modulus;
+         if (exponent.bit (index)) {
+            result *= reduced;
+            result %= modulus;
+         }
       }
-      else if (ubig_int.ubig_value[i] == '0'
-                && ubig_int.ubig_value[i-1] == '0') {
-         ubig_int.ubig_value.pop_back();
-         break;
+      return result;
+   }
+
+   // Montgomery form of x is x * R mod m, where R = 2^(32n).
+   const ubigvalue_t& m = modulus.ubig_value;
+   size_t n = m.size();
+   ubigint::udigit_t inverse = m[0];
+   for (int step = 0; step < 4; ++step) inverse *= 2 - m[0] * inverse;
+   ubigint::udigit_t minv = 0 - inverse;
+   auto to_montgomery = [&] (ubigint value) {
+      value <<= n * ubigint::UDIGIT_BITS;
+      value %= modulus;
+      value.ubig_value.resize (n);
+      return value.ubig_value;
+   };
+   ubigvalue_t x = to_montgomery (result);
+   ubigvalue_t b = to_montgomery (reduced);
+   ubigvalue_t product;
+   product.resize (2 * n);
+   for (size_t index = bits; index-- > 0; ) {
+      limbs_sqr (product.data(), x.data(), n);
+      limbs_redc (x.data(), product.data(), m.data(), n, minv);
+      if (exponent.bit (index)) {
+         limbs_mul (product.data(), x.data(), n, b.data(), n);
+         limbs_redc (x.data(), product.data(), m.data(), n, minv);
       }
-      else break;
    }
-   this->ubig_value.clear();
-   this->ubig_value = ubig_int.ubig_value;
+   fill (copy (x.begin(), x.end(), product.begin()), product.end(), 0);
+   result.ubig_value.resize (n);
+   limbs_redc (result.ubig_value.data(), product.data(), m.data(), n,
+               minv);
+   result.trim();
+   return result;
 }
 
-void ubigint::divide_by_2() {
-   
-   vector<unsigned char> answer;
-   int calc;
-   int sub;
-   int dividend = this->ubig_value.back() - '0';
-   int i;
+ubigint usqrt (const ubigint& n) {
+   using uword = unsigned __int128;
+   if (n.is_word()) {
+      ubigint::udigit2_t value = n.word();
+      uword root = static_cast<ubigint::udigit2_t>
+                   (sqrtl (static_cast<long double> (value)));
+      while (root * root > value) --root;
+      while ((root + 1) * (root + 1) <= value) ++root;
+      return ubigint (static_cast<ubigint::udigit2_t> (root));
+   }
+   // (usqrt (n / 4^k) + 1) * 2^k is at least sqrt (n), so Newton's
+   // iteration from there falls to the floor of the root and stops.
+   size_t half = n.bit_length() / 4;
+   ubigint high = n;
+   high >>= 2 * half;
+   ubigint root = usqrt (high) + ubigint (1);
+   root <<= half;
+   for (;;) {
+      ubigint next = n / root;
+      next += root;
+      next >>= 1;
+      if (not (next < root)) return root;
+      root = move (next);
+   }
+}
 
-   for (i = this->ubig_value.size() - 1; i >= 0; --i) {
-      if (dividend < 2) {
-         answer.push_back('0');
-         if (dividend == 0) {
-            dividend = (this->ubig_value[i - 1] - '0');
-         }
-         else {
-            dividend = (this->ubig_value[i - 1] - '0') 
-                        + (dividend * 10);
+ubigint::udigit2_t ubigint::bits_from (size_t index) const {
+   using uword = unsigned __int128;
+   size_t limb = index / UDIGIT_BITS;
+   uword bits = 0;
+   for (size_t count = 0; count < 3; ++count) {
+      if (limb + count >= ubig_value.size()) break;
+      uword digit = ubig_value[limb + count];
+      bits |= digit << (count * UDIGIT_BITS);
+   }
+   return static_cast<udigit2_t> (bits >> index % UDIGIT_BITS);
+}
+
+ubigint ugcd (ubigint u, ubigint v) {
+   using sword = __int128;
+   using udigit2_t = ubigint::udigit2_t;
+   if (u < v) swap (u, v);
+   auto magnitude = [] (sword value) {
+      return ubigint (static_cast<udigit2_t> (value < 0 ? -value
+                                                        : value));
+   };
+   // a * x + b * y where a and b differ in sign and the result is
+   // known not to be negative.
+   auto combine = [&] (const ubigint& x, sword a,
+                       const ubigint& y, sword b) {
+      ubigint ax = x * magnitude (a);
+      ubigint by = y * magnitude (b);
+      return a > 0 ? ax - by : by - ax;
+   };
+   while (not v.is_zero()) {
+      if (u.is_word()) {
+         udigit2_t x = u.word();
+         udigit2_t y = v.word();
+         while (y != 0) {
+            udigit2_t rest = x % y;
+            x = y;
+            y = rest;
          }
+         return ubigint (x);
       }
-      else {
-         calc = dividend / 2;
-         answer.push_back(calc + '0');
-         if(i == 0) break;
-         else {
-            sub = dividend - (2 * calc);
-            dividend = (sub * 10) 
-                        + (this->ubig_value[i - 1] - '0');
-         }
-      }    
-   }
-   this->ubig_value.clear();
-   for (i = answer.size() - 1; i >= 0; --i) {
-      this->ubig_value.push_back(answer[i]);
-   }
-   for (i = this->ubig_value.size() - 1; i >= 0; --i) {
-      if(this->ubig_value[i] != '0') break;
-      else this->ubig_value.pop_back();
-   } 
-}
-
-struct quo_rem { ubigint quotient; ubigint remainder; };
-quo_rem udivide (const ubigint& dividend, ubigint divisor) {
-   // Note: divisor is modified so pass by value (copy).
-   ubigint zero {0};
-   if (divisor == zero) throw domain_error ("udivide by zero");
-   ubigint power_of_2 {1};
-   ubigint quotient {0};
-   ubigint remainder {dividend}; // left operand, dividend
-   while (divisor < remainder) {
-      divisor.multiply_by_2();
-      power_of_2.multiply_by_2();
-   }
-   while (power_of_2 > zero) {
-      if (divisor <= remainder) {
-         remainder = remainder - divisor;
-         quotient = quotient + power_of_2;
+      size_t shift = u.bit_length() - 62;
+      sword uhat = u.bits_from (shift);
+      sword vhat = v.bits_from (shift);
+      sword a = 1, b = 0, c = 0, d = 1;
+      while (vhat + c != 0 and vhat + d != 0) {
+         sword quotient = (uhat + a) / (vhat + c);
+         if (quotient != (uhat + b) / (vhat + d)) break;
+         sword next = a - quotient * c;
+         a = c;
+         c = next;
+         next = b - quotient * d;
+         b = d;
+         d = next;
+         next = uhat - quotient * vhat;
+         uhat = vhat;
+         vhat = next;
+      }
+      if (b == 0) {
+         u %= v;
+         swap (u, v);
+      }else {
+         ubigint x = combine (u, a, v, b);
+         v = combine (u, c, v, d);
+         u = move (x);
       }
-      divisor.divide_by_2();
-      power_of_2.divide_by_2();
    }
-   return {.quotient = quotient, .remainder = remainder};
+   return u;
 }
 
 ubigint ubigint::operator/ (const ubigint& that) const {
-   return udivide (*this, that).quotient;
+   if (is_word() and that.is_word()) {
+      ubigint result {*this};
+      return result /= that;
+   }
+   static thread_local ubigvalue_t spare;
+   ubigvalue_t remainder;
+   remainder.swap (spare);
+   ubigint result;
+   divrem (*this, that, result.ubig_value, remainder);
+   spare.swap (remainder);
+   return result;
 }
 
 ubigint ubigint::operator% (const ubigint& that) const {
-   return udivide (*this, that).remainder;
+   if (is_word() and that.is_word()) {
+      ubigint result {*this};
+      return result %= that;
+   }
+   static thread_local ubigvalue_t spare;
+   ubigvalue_t quotient;
+   quotient.swap (spare);
+   ubigint result;
+   divrem (*this, that, quotient, result.ubig_value);
+   spare.swap (quotient);
+   return result;
 }
 
 bool ubigint::operator== (const ubigint& that) const {
+   return ubig_value == that.ubig_value;
+}
 
-   int this_size = this->ubig_value.size();
-   int that_size = that.ubig_value.size();
-   bool is_eq = false;
-   bool eq_len = false;
-   int i;
-
-   eq_len = (this_size == that_size);
-   if (eq_len) {
-      is_eq = true;
-      for (i = 0; i < this_size; ++i) {
-         if(this->ubig_value[i] != that.ubig_value[i]) {
-            is_eq = false;
-            return is_eq;
-         }
+bool ubigint::operator< (const ubigint& that) const {
+   if (ubig_value.size() != that.ubig_value.size()) {
+      return ubig_value.size() < that.ubig_value.size();
+   }
+   for (size_t index = ubig_value.size(); index-- > 0; ) {
+      if (ubig_value[index] != that.ubig_value[index]) {
+         return ubig_value[index] < that.ubig_value[index];
       }
    }
-   return is_eq;
+   return false;
 }
 
-bool ubigint::operator< (const ubigint& that) const {
-   
-   int this_size = this->ubig_value.size();
-   int that_size = that.ubig_value.size();
-   int i;   
-
-   if (this_size > that_size) return false;
-   else if (this_size < that_size) return true;
-   else {
-      for (i = this_size - 1; i >= 0; --i) {
-         if ((this->ubig_value[i] != that.ubig_value[i])
-             && (this->ubig_value[i] < that.ubig_value[i])) {
-            return true;
-         }
-         else if ((this->ubig_value[i] != that.ubig_value[i])
-             && (this->ubig_value[i] > that.ubig_value[i])) {
-            return false;
+//
+// Decimal conversion.
+//    Digits are handled in chunks of nine, one chunk per limb.  Up
+//    to limb_thresholds::radix_dc limbs the schoolbook loops are
+//    used.  Above that the number is split around a power
+//    10^(9*2^k), chosen so the two halves are about the same size,
+//    and each half is converted recursively, so that the cost
+//    follows the multiplication and division algorithms.  The
+//    powers are built on demand by repeated squaring.
+//    A million digits take about 0.45 s to read and 1.3 s to print
+//    at -O2, and 1.7 s and 6.2 s at the -O0 of the Makefile.  Both
+//    are bound by the NTT products of the top levels, and printing
+//    more so, since every split is a division.
+//
+
+const ubigint& ubigint::chunk_power (size_t level,
+                                     vector<ubigint>& powers) {
+   if (powers.empty()) powers.push_back (ubigint (DEC_CHUNK));
+   while (powers.size() <= level) {
+      powers.push_back (powers.back() * powers.back());
+   }
+   return powers[level];
+}
+
+ubigint ubigint::from_decimal (const char* digits, size_t length) {
+   if (length <= WORD_DIGITS) {
+      udigit2_t value = 0;
+      for (size_t index = 0; index < length; ++index) {
+         value = value * 10 + (digits[index] - '0');
+      }
+      ubigint result;
+      result.set_words (value);
+      return result;
+   }
+   // chunks[0] holds the least significant nine digits.
+   vector<udigit_t> chunks ((length + DEC_CHUNK_DIGITS - 1)
+                            / DEC_CHUNK_DIGITS);
+   const char* end = digits + length;
+   for (udigit_t& chunk: chunks) {
+      const char* start = end - min<size_t> (end - digits,
+                                             DEC_CHUNK_DIGITS);
+      chunk = 0;
+      for (const char* digit = start; digit < end; ++digit) {
+         chunk = chunk * 10 + (*digit - '0');
+      }
+      end = start;
+   }
+   vector<ubigint> powers;
+   return from_chunks (chunks.data(), chunks.size(), powers);
+}
+
+ubigint ubigint::from_chunks (const udigit_t* chunks, size_t count,
+                              vector<ubigint>& powers) {
+   ubigint result;
+   if (count <= max (limb_thresholds::radix_dc, MIN_RADIX_LIMBS)) {
+      // 10^9 < 2^32, so count limbs always hold count chunks.
+      result.ubig_value.resize (count);
+      udigit_t* data = result.ubig_value.data();
+      for (size_t used = 0; used < count; ++used) {
+         data[used] = limbs_mul_1 (data, data, used, DEC_CHUNK);
+         limbs_add_1 (data, data, used + 1, chunks[count - used - 1]);
+      }
+      result.trim();
+      return result;
+   }
+   size_t level = 0;
+   while ((size_t (2) << level) < count) ++level;
+   size_t low_count = size_t (1) << level;
+   result = from_chunks (chunks + low_count, count - low_count, powers);
+   result *= chunk_power (level, powers);
+   result += from_chunks (chunks, low_count, powers);
+   return result;
+}
+
+//
+// Horner's rule, a word's worth of digits at a time.  A digit may
+// be larger than the radix, as dc allows, so the scale of a word is
+// kept below 2^32 to leave room for the carry.
+//
+ubigint ubigint::from_radix (string_view digits, udigit_t radix) {
+   ubigint result;
+   udigit2_t chunk = 0;
+   udigit2_t scale = 1;
+   for (char digit: digits) {
+      if (scale * radix > numeric_limits<udigit_t>::max()) {
+         result *= ubigint (scale);
+         result += ubigint (chunk);
+         chunk = 0;
+         scale = 1;
+      }
+      udigit_t value = isdigit (digit) ? digit - '0' : digit - 'A' + 10;
+      chunk = chunk * radix + value;
+      scale *= radix;
+   }
+   result *= ubigint (scale);
+   result += ubigint (chunk);
+   return result;
+}
+
+static void append_chunk (string& out, uint32_t chunk, int digits) {
+   char buffer[DEC_CHUNK_DIGITS];
+   for (int index = digits; index-- > 0; chunk /= 10) {
+      buffer[index] = '0' + chunk % 10;
+   }
+   out.append (buffer, digits);
+}
+
+void ubigint::append_decimal (string& out, size_t width,
+                              vector<ubigint>& powers) const {
+   if (ubig_value.size() <= max (limb_thresholds::radix_dc,
+                                 MIN_RADIX_LIMBS)) {
+      ubigvalue_t scratch = ubig_value;
+      vector<udigit_t> chunks;
+      while (not scratch.empty()) {
+         chunks.push_back (limbs_divrem_1 (scratch.data(),
+               scratch.data(), scratch.size(), DEC_CHUNK));
+         if (scratch.back() == 0) scratch.pop_back();
+      }
+      size_t digits = 0;
+      if (not chunks.empty()) {
+         digits = std::to_string (chunks.back()).size();
+         digits += (chunks.size() - 1) * DEC_CHUNK_DIGITS;
+      }
+      if (width > digits) out.append (width - digits, '0');
+      for (size_t index = chunks.size(); index-- > 0; ) {
+         append_chunk (out, chunks[index],
+                       index + 1 == chunks.size()
+                       ? digits - index * DEC_CHUNK_DIGITS
+                       : DEC_CHUNK_DIGITS);
+      }
+      return;
+   }
+   // Estimate the chunk count from the limb count (32 log10 2 / 9
+   // is about 137/128) and split at the largest 10^(9*2^level) with
+   // 2^level at most half of it, which keeps the divisor below us.
+   size_t chunks = ubig_value.size() * 137 / 128;
+   size_t level = 0;
+   while ((size_t (4) << level) <= chunks) ++level;
+   quo_rem parts = udivide (*this, chunk_power (level, powers));
+   size_t low_width = DEC_CHUNK_DIGITS << level;
+   size_t high_width = width > 0 ? width - low_width : 0;
+   parts.quotient.append_decimal (out, high_width, powers);
+   parts.remainder.append_decimal (out, low_width, powers);
+}
+
+void ubigint::append_string (string& out) const {
+   if (ubig_value.empty()) {
+      out += '0';
+      return;
+   }
+   // Under ten digits a limb, and two characters every 69 digits.
+   size_t digits = ubig_value.size() * 10;
+   out.reserve (out.size() + digits + digits / 34 + 2);
+   vector<ubigint> powers;
+   append_decimal (out, 0, powers);
+}
+
+void ubigint::append_digits (vector<udigit_t>& out, size_t width,
+                             udigit_t radix, unsigned chunk_digits,
+                             vector<ubigint>& powers) const {
+   udigit_t chunk = 1;
+   for (unsigned count = 0; count < chunk_digits; ++count) {
+      chunk *= radix;
+   }
+   if (ubig_value.size() <= max (limb_thresholds::radix_dc,
+                                 MIN_RADIX_LIMBS)) {
+      ubigvalue_t scratch = ubig_value;
+      vector<udigit_t> digits; // Least significant first.
+      while (not scratch.empty()) {
+         udigit_t rest = limbs_divrem_1 (scratch.data(), scratch.data(),
+                                         scratch.size(), chunk);
+         if (scratch.back() == 0) scratch.pop_back();
+         for (unsigned count = 0; count < chunk_digits; ++count) {
+            digits.push_back (rest % radix);
+            rest /= radix;
          }
       }
+      while (not digits.empty() and digits.back() == 0) {
+         digits.pop_back();
+      }
+      if (width > digits.size()) {
+         out.insert (out.end(), width - digits.size(), 0);
+      }
+      out.insert (out.end(), digits.rbegin(), digits.rend());
+      return;
    }
-   return false;
+   if (powers.empty()) powers.push_back (ubigint (chunk));
+   double chunk_bits = chunk_digits * log2 (radix);
+   size_t chunks = static_cast<size_t> (bit_length() / chunk_bits);
+   size_t level = 0;
+   while ((size_t (4) << level) <= chunks) ++level;
+   quo_rem parts = udivide (*this, chunk_power (level, powers));
+   size_t low_width = size_t (chunk_digits) << level;
+   size_t high_width = width > 0 ? width - low_width : 0;
+   parts.quotient.append_digits (out, high_width, radix, chunk_digits,
+                                 powers);
+   parts.remainder.append_digits (out, low_width, radix, chunk_digits,
+                                  powers);
 }
 
-ostream& operator<< (ostream& out, const ubigint& that) { 
-   int that_size = that.ubig_value.size();
-   int i;
-   for (i = that_size - 1; i >= 0; --i) {
-      out << that.ubig_value[i];
-      if (i%69 == 0 && i!=0) {
-         out << "\\\n";
+void ubigint::append_radix (string& out, unsigned radix) const {
+   if (radix == 10) {
+      append_string (out);
+      return;
+   }
+   // Zero is a bare 0 in every radix, not a padded digit.
+   if (is_zero()) {
+      out += '0';
+      return;
+   }
+   vector<udigit_t> digits;
+   if ((radix & (radix - 1)) == 0) {
+      unsigned bits = __builtin_ctz (radix);
+      udigit2_t mask = radix - 1;
+      for (size_t index = (bit_length() + bits - 1) / bits;
+           index-- > 0; ) {
+         digits.push_back (bits_from (index * bits) & mask);
       }
+   }else {
+      unsigned chunk_digits = 1;
+      for (udigit2_t chunk = radix; chunk * radix <= UINT32_MAX;
+           chunk *= radix) ++chunk_digits;
+      vector<ubigint> powers;
+      append_digits (digits, 0, radix, chunk_digits, powers);
+   }
+   if (radix <= 16) {
+      out.reserve (out.size() + digits.size() * 71 / 69 + 2);
+      for (udigit_t digit: digits) out += "0123456789ABCDEF"[digit];
+      return;
    }
-   //out << endl;
-   return out;
+   size_t width = std::to_string (radix - 1).size();
+   for (udigit_t digit: digits) {
+      string text = std::to_string (digit);
+      out += ' ';
+      out.append (width - text.size(), '0');
+      out += text;
+   }
+}
+
+string ubigint::to_string() const {
+   string result;
+   append_string (result);
+   return result;
+}
+
+void wrap_lines (string& text, size_t start) {
+   static const size_t LINE_DIGITS = 69;
+   size_t length = text.size() - start;
+   if (length <= LINE_DIGITS + 1) return;
+   // The last line may take one more character than the others.
+   size_t breaks = (length - 2) / LINE_DIGITS;
+   text.resize (text.size() + 2 * breaks);
+   char* data = &text[start];
+   size_t from = breaks * LINE_DIGITS;
+   size_t to = from + 2 * breaks;
+   memmove (data + to, data + from, length - from);
+   while (from > 0) {
+      data[--to] = '\n';
+      data[--to] = '\\';
+      from -= LINE_DIGITS;
+      to -= LINE_DIGITS;
+      memmove (data + to, data + from, LINE_DIGITS);
+   }
+}
+
+ostream& operator<< (ostream& out, const ubigint& that) {
+   // Kept between calls so that its space is only allocated once.
+   static thread_local string text;
+   text.clear();
+   that.append_string (text);
+   wrap_lines (text);
+   return out.write (text.data(), text.size());
 }
 
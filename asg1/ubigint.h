@@ -1,31 +1,105 @@
 #ifndef __UBIGINT_H__
 #define __UBIGINT_H__
 
+#include <cstdint>
 #include <exception>
 #include <iostream>
 #include <limits>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 using namespace std;
 
 #include "debug.h"
+#include "limbpool.h"
 #include "relops.h"
+#include "smallvec.h"
+
+struct quo_rem;
+
+//
+// ubigint -
+//    Unsigned arbitrary precision integer.  The value is kept as a
+//    vector of 32-bit binary limbs, least significant limb first,
+//    with no high order zero limbs, so zero is the empty vector.
+//    Decimal is used only when converting from and to strings.
+//
+//    Up to two words (four limbs) are stored inline, and when both
+//    operands fit in one 64-bit word the arithmetic is done with
+//    native instructions, so values that fit in a machine word never
+//    touch the heap.  A result that overflows the word is simply
+//    written out as more limbs.  Larger values take their storage
+//    from limbpool.
+//
 
 class ubigint {
    friend ostream& operator<< (ostream&, const ubigint&);
+   friend quo_rem udivide (const ubigint&, const ubigint&);
+   friend ubigint upowmod (const ubigint&, const ubigint&,
+                           const ubigint&);
+   friend ubigint usqrt (const ubigint&);
+   friend ubigint ugcd (ubigint, ubigint);
    private:
-      // REMOVE THIS BEFORE SUBMITTING
-      //using unumber = unsigned long;
-      //unumber uvalue {};
-      using udigit_t = unsigned char;
-      using ubigvalue_t = vector<udigit_t>;
+      using udigit_t = uint32_t;
+      using udigit2_t = uint64_t;
+      static constexpr int UDIGIT_BITS = 32;
+      static constexpr size_t INLINE_LIMBS = 4;
+      using ubigvalue_t = smallvec<udigit_t,INLINE_LIMBS,
+                                   pool_allocator<udigit_t>>;
       ubigvalue_t ubig_value;
+      void trim();
+      bool is_word() const { return ubig_value.size() <= 2; }
+      udigit2_t word() const;
+      udigit2_t bits_from (size_t index) const;
+      void set_words (udigit2_t low, udigit2_t high = 0);
+      static const ubigint& chunk_power (size_t level,
+                                         vector<ubigint>& powers);
+      static ubigint from_decimal (const char* digits, size_t length);
+      static ubigint from_chunks (const udigit_t* chunks, size_t count,
+                                  vector<ubigint>& powers);
+      void append_decimal (string& out, size_t width,
+                           vector<ubigint>& powers) const;
+      static ubigint from_radix (string_view digits, udigit_t radix);
+      void append_digits (vector<udigit_t>& out, size_t width,
+                          udigit_t radix, unsigned chunk_digits,
+                          vector<ubigint>& powers) const;
+      static void divrem (const ubigint& dividend,
+                          const ubigint& divisor,
+                          ubigvalue_t& quotient,
+                          ubigvalue_t& remainder);
    public:
-      void multiply_by_2();
-      void divide_by_2();
-
       ubigint() = default; // Need default ctor as well.
       ubigint (unsigned long);
-      ubigint (const string&);
+      ubigint (string_view); // Decimal digits.
+      ubigint (string_view, unsigned radix); // Digits 0-9 and A-F.
+
+      //
+      // The compound operators work in the existing storage where
+      // they can, so loops that update one value do not allocate
+      // once its capacity has grown to fit.  subtract_from computes
+      // that - *this, for when the larger operand is on the right.
+      //
+      ubigint& operator+= (const ubigint&);
+      ubigint& operator-= (const ubigint&);
+      ubigint& operator*= (const ubigint&);
+      ubigint& operator/= (const ubigint&);
+      ubigint& operator%= (const ubigint&);
+      ubigint& operator<<= (size_t bits);
+      ubigint& operator>>= (size_t bits);
+      ubigint& subtract_from (const ubigint&);
+
+      bool is_zero() const { return ubig_value.empty(); }
+      bool is_odd() const {
+         return not ubig_value.empty() and (ubig_value[0] & 1);
+      }
+      size_t bit_length() const;
+      uint64_t low_word() const { return word(); }
+      bool bit (size_t index) const {
+         size_t limb = index / UDIGIT_BITS;
+         return limb < ubig_value.size()
+            and (ubig_value[limb] >> index % UDIGIT_BITS & 1);
+      }
 
       ubigint operator+ (const ubigint&) const;
       ubigint operator- (const ubigint&) const;
@@ -35,7 +109,68 @@ class ubigint {
 
       bool operator== (const ubigint&) const;
       bool operator<  (const ubigint&) const;
+
+      // Appends the decimal digits, reserving room for the line
+      // breaks that wrap_lines will add.
+      void append_string (string& out) const;
+
+      //
+      // Appends the digits in a radix from 2 to 2^32-1, the way dc
+      // prints them: 0-9 and A-F up to 16, and above it each digit
+      // in decimal, padded to the width of the largest, after a
+      // space.  Powers of two are sliced straight from the limbs;
+      // other radices divide and conquer as decimal does.
+      //
+      void append_radix (string& out, unsigned radix) const;
+      string to_string() const;
 };
 
+//
+// udivide -
+//    Quotient and remainder from a single long division.  Throws
+//    domain_error if the divisor is zero.
+//
+
+struct quo_rem { ubigint quotient; ubigint remainder; };
+quo_rem udivide (const ubigint& dividend, const ubigint& divisor);
+
+//
+// upowmod -
+//    base^exponent mod modulus, reducing after every step so that
+//    nothing grows past twice the size of the modulus.  Moduli that
+//    fit in a word use native 128-bit arithmetic, other odd moduli
+//    Montgomery multiplication, and even ones plain division.
+//    Throws domain_error if the modulus is zero.
+//
+
+ubigint upowmod (const ubigint& base, const ubigint& exponent,
+                 const ubigint& modulus);
+
+//
+// usqrt -
+//    The integer square root, floor (sqrt (n)).  The root of the
+//    high half of the bits, found recursively, starts a Newton
+//    iteration that is then within a few steps of the answer, so
+//    the whole costs a few divisions of the full size.
+//
+// ugcd -
+//    Greatest common divisor by Lehmer's method: Euclid's quotients
+//    are found from the leading 62 bits alone for as long as they
+//    are sure to be right, and then applied to the whole numbers
+//    in one linear combination, so most steps touch no limbs.
+//
+
+ubigint usqrt (const ubigint& n);
+ubigint ugcd (ubigint u, ubigint v);
+
+//
+// wrap_lines -
+//    Break the text from start on the way dc does, after every 69
+//    characters with a trailing backslash, in place and in a single
+//    pass from the back.
+//
+
+void wrap_lines (string& text, size_t start = 0);
+
 #endif
 
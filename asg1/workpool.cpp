@@ -0,0 +1,121 @@
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "workpool.h"
+
+struct join_group {
+   size_t pending;
+   exception_ptr error;
+};
+
+struct queued_task {
+   const workpool::task_ref* work;
+   join_group* group;
+};
+
+//
+// pool_state -
+//    One mutex guards the queue and every join_group's counters;
+//    one condition variable announces both new work and finished
+//    groups.  The destructor stops and joins the workers at exit.
+//
+struct pool_state {
+   mutex lock;
+   condition_variable changed;
+   deque<queued_task> queue;
+   vector<thread> workers;
+   size_t thread_count {1};
+   bool stopping {false};
+   void run (queued_task task, unique_lock<mutex>& held);
+   void work();
+   void stop();
+   ~pool_state() { stop(); }
+};
+
+static pool_state pool;
+
+void pool_state::run (queued_task task, unique_lock<mutex>& held) {
+   held.unlock();
+   exception_ptr error;
+   try {
+      (*task.work)();
+   }catch (...) {
+      error = current_exception();
+   }
+   held.lock();
+   if (error and not task.group->error) task.group->error = error;
+   if (--task.group->pending == 0) changed.notify_all();
+}
+
+void pool_state::work() {
+   unique_lock<mutex> held (lock);
+   for (;;) {
+      changed.wait (held, [this] {
+         return stopping or not queue.empty();
+      });
+      if (queue.empty()) return;
+      queued_task task = queue.front();
+      queue.pop_front();
+      run (task, held);
+   }
+}
+
+void pool_state::stop() {
+   {
+      lock_guard<mutex> held (lock);
+      stopping = true;
+   }
+   changed.notify_all();
+   for (thread& worker: workers) worker.join();
+   workers.clear();
+   stopping = false;
+}
+
+
+void workpool::set_threads (size_t count) {
+   pool.stop();
+   pool.thread_count = count > 0 ? count : 1;
+   for (size_t index = 1; index < pool.thread_count; ++index) {
+      pool.workers.emplace_back ([] { pool.work(); });
+   }
+}
+
+size_t workpool::threads() {
+   return pool.thread_count;
+}
+
+void workpool::fork_join (const task_ref* tasks, size_t count) {
+   if (pool.workers.empty() or count < 2) {
+      for (size_t index = 0; index < count; ++index) tasks[index]();
+      return;
+   }
+   join_group group {count, nullptr};
+   unique_lock<mutex> held (pool.lock);
+   for (size_t index = 1; index < count; ++index) {
+      pool.queue.push_back ({&tasks[index], &group});
+   }
+   pool.changed.notify_all();
+   pool.run ({&tasks[0], &group}, held);
+   while (group.pending > 0) {
+      auto own = find_if (pool.queue.begin(), pool.queue.end(),
+                          [&group] (const queued_task& task) {
+                             return task.group == &group;
+                          });
+      if (own == pool.queue.end()) {
+         pool.changed.wait (held);
+      }else {
+         queued_task task = *own;
+         pool.queue.erase (own);
+         pool.run (task, held);
+      }
+   }
+   if (group.error) rethrow_exception (group.error);
+}
+
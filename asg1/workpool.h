@@ -0,0 +1,55 @@
+//
+// workpool -
+//    A process-wide pool of worker threads for fork/join
+//    parallelism inside the arithmetic kernels.  The pool starts
+//    with one thread, the caller, so nothing runs concurrently
+//    until set_threads is given a larger count (ydc -j N).
+//
+// set_threads -
+//    Cap the number of threads working at once, counting the one
+//    that calls fork_join.  Starts or stops workers to match.
+// threads -
+//    The current cap.
+// task_ref -
+//    A reference to something callable, which forking neither
+//    copies nor allocates.  The callable must outlive the fork_join
+//    that runs it.
+// fork_join -
+//    Run every task, possibly concurrently, and return once all of
+//    them have finished.  A thread waiting here runs its own
+//    group's queued tasks itself rather than sleeping, so nested
+//    fork_joins cannot deadlock the pool.  It never runs another
+//    group's task, which could reenter whatever the waiting caller
+//    is in the middle of, such as its per-thread scratch or a
+//    piece's output stream.  The first exception thrown by a task
+//    is rethrown to the caller.
+//
+
+#ifndef __WORKPOOL_H__
+#define __WORKPOOL_H__
+
+#include <cstddef>
+using namespace std;
+
+class workpool {
+   public:
+      class task_ref {
+         private:
+            void* callable;
+            void (*invoke) (void*);
+         public:
+            template <typename callable_t>
+            task_ref (callable_t& work):
+                      callable(&work),
+                      invoke([] (void* work) {
+                         (*static_cast<callable_t*> (work))();
+                      }) {}
+            void operator()() const { invoke (callable); }
+      };
+      static void set_threads (size_t count);
+      static size_t threads();
+      static void fork_join (const task_ref* tasks, size_t count);
+};
+
+#endif
+